@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <afina/logging/Config.h>
+#include <afina/network/Config.h>
+#include <afina/network/Server.h>
+
+#include "logging/ServiceImpl.h"
+#include "network/mt_blocking/ServerImpl.h"
+#include "network/mt_nonblocking/ServerImpl.h"
+#include "network/st_blocking/ServerImpl.h"
+#include "network/st_coroutine/ServerImpl.h"
+#include "network/st_nonblocking/ServerImpl.h"
+#include "storage/SimpleLRU.h"
+
+using namespace Afina;
+
+static std::shared_ptr<Network::Server> MakeServer(const std::string &type, std::shared_ptr<Storage> ps,
+                                                   std::shared_ptr<Logging::Service> pl,
+                                                   std::shared_ptr<Network::Config> pc) {
+    if (type == "st_block") {
+        return std::make_shared<Network::STblocking::ServerImpl>(ps, pl, pc);
+    } else if (type == "mt_block") {
+        return std::make_shared<Network::MTblocking::ServerImpl>(ps, pl, pc);
+    } else if (type == "st_nonblock") {
+        return std::make_shared<Network::STnonblock::ServerImpl>(ps, pl, pc);
+    } else if (type == "mt_nonblock") {
+        return std::make_shared<Network::MTnonblock::ServerImpl>(ps, pl, pc);
+    } else if (type == "st_coroutine") {
+        return std::make_shared<Network::STcoroutine::ServerImpl>(ps, pl, pc);
+    }
+    throw std::runtime_error("Unknown network type: " + type);
+}
+
+// Server starts listening in background, so connect is retried for a while
+static int Connect(const struct sockaddr *addr, socklen_t len) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int fd = socket(addr->sa_family, SOCK_STREAM, 0);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open socket: " + std::string(strerror(errno)));
+        }
+        if (connect(fd, addr, len) == 0) {
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    throw std::runtime_error("Failed to connect: " + std::string(strerror(errno)));
+}
+
+// Sends request and reads until response ends with the given suffix
+static void RoundTrip(int fd, const std::string &request, const std::string &end, std::string &buffer) {
+    if (write(fd, request.data(), request.size()) != ssize_t(request.size())) {
+        throw std::runtime_error("Failed to send request");
+    }
+
+    buffer.clear();
+    char chunk[4096];
+    while (buffer.size() < end.size() || buffer.compare(buffer.size() - end.size(), end.size(), end) != 0) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) {
+            throw std::runtime_error("Connection closed by server");
+        }
+        buffer.append(chunk, n);
+    }
+}
+
+// Runs one request at a time over the given connection and reports round trip latency distribution
+static void Run(const std::string &title, int fd, size_t requests) {
+    std::string buffer;
+    RoundTrip(fd, "set bench 0 0 5\r\nvalue\r\n", "STORED\r\n", buffer);
+
+    std::vector<double> latency;
+    latency.reserve(requests);
+    for (size_t i = 0; i < requests; i++) {
+        auto start = std::chrono::steady_clock::now();
+        RoundTrip(fd, "get bench\r\n", "END\r\n", buffer);
+        auto end = std::chrono::steady_clock::now();
+        latency.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(end - start).count());
+    }
+
+    double total = 0;
+    for (double l : latency) {
+        total += l;
+    }
+    std::sort(latency.begin(), latency.end());
+    std::cout << title << ": " << requests << " requests, avg " << (total / requests) << "us, p50 "
+              << latency[requests / 2] << "us, p99 " << latency[requests * 99 / 100] << "us, "
+              << (requests / total * 1e6) << " rps" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::string type = "st_nonblock";
+    if (argc > 1) {
+        type = argv[1];
+    }
+    size_t requests = 100000;
+    if (argc > 2) {
+        requests = std::strtoul(argv[2], nullptr, 10);
+    }
+    uint16_t port = 8090;
+    if (argc > 3) {
+        port = std::strtoul(argv[3], nullptr, 10);
+    }
+    size_t busy_poll = 0;
+    if (argc > 4) {
+        busy_poll = std::strtoul(argv[4], nullptr, 10);
+    }
+    if (requests == 0) {
+        std::cerr << "Usage: " << argv[0] << " [network] [requests] [port] [busy poll us]" << std::endl;
+        return 1;
+    }
+
+    // Keep logs quiet, they would dominate the measurement
+    auto log_config = std::make_shared<Logging::Config>();
+    Logging::Appender &console = log_config->appenders["console"];
+    console.type = Logging::Appender::Type::STDERR;
+    console.color = false;
+    Logging::Logger &logger = log_config->loggers["root"];
+    logger.level = Logging::Logger::Level::ERROR;
+    logger.appenders.push_back("console");
+    auto log_service = std::make_shared<Logging::ServiceImpl>(log_config);
+    log_service->Start();
+
+    auto storage = std::make_shared<Backend::SimpleLRU>();
+    storage->Start();
+
+    auto config = std::make_shared<Network::Config>();
+    config->unix_socket = "/tmp/afina-bench-" + std::to_string(getpid()) + ".sock";
+    config->busy_poll = busy_poll;
+    auto server = MakeServer(type, storage, log_service, config);
+    server->Start(port, 1, 2);
+
+    struct sockaddr_in tcp_addr;
+    std::memset(&tcp_addr, 0, sizeof(tcp_addr));
+    tcp_addr.sin_family = AF_INET;
+    tcp_addr.sin_port = htons(port);
+    tcp_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    struct sockaddr_un unix_addr;
+    std::memset(&unix_addr, 0, sizeof(unix_addr));
+    unix_addr.sun_family = AF_UNIX;
+    std::strncpy(unix_addr.sun_path, config->unix_socket.c_str(), sizeof(unix_addr.sun_path) - 1);
+
+    // Blocking servers serve one connection at a time per thread, so connections are measured in turn
+    int tcp_fd = Connect((struct sockaddr *)&tcp_addr, sizeof(tcp_addr));
+    int opt = 1;
+    setsockopt(tcp_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    Run(type + ", tcp loopback", tcp_fd, requests);
+    close(tcp_fd);
+
+    int unix_fd = Connect((struct sockaddr *)&unix_addr, sizeof(unix_addr));
+    Run(type + ", unix socket ", unix_fd, requests);
+    close(unix_fd);
+
+    server->Stop();
+    server->Join();
+    storage->Stop();
+    log_service->Stop();
+    unlink(config->unix_socket.c_str());
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include <protocol/Parser.h>
+
+#include "network/CommandStream.h"
+#include "storage/SimpleLRU.h"
+
+using namespace Afina;
+
+// Replays given input through the parser as if it arrives from the network in a single read and
+// reports how many lines per second could be handled
+template <typename F> static void Run(const std::string &title, const std::string &line, size_t lines, F on_line) {
+    std::string input;
+    input.reserve(line.size() * lines);
+    for (size_t i = 0; i < lines; i++) {
+        input.append(line);
+    }
+
+    Protocol::Parser parser;
+    size_t handled = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    const char *p = input.data();
+    size_t left = input.size();
+    while (left > 0) {
+        size_t parsed = 0;
+        if (parser.Parse(p, left, parsed)) {
+            handled += on_line(parser);
+            parser.Reset();
+        }
+        p += parsed;
+        left -= parsed;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    std::cout << title << ": " << handled << " lines in " << seconds << "s, " << (handled / seconds / 1e6)
+              << " Mlines/s" << std::endl;
+}
+
+// Valid command gets built into the command reused between lines
+static size_t Build(Protocol::Parser &parser) {
+    static Execute::Command command;
+    size_t body_size = 0;
+    command.Reset();
+    return parser.Build(body_size, command) ? 1 : 0;
+}
+
+// Parser reports error by status code, connection answers and keeps going
+static size_t ErrorCode(Protocol::Parser &parser) {
+    static Execute::Response out;
+    if (parser.Failed()) {
+        parser.BuildError(out);
+        out.Clear();
+    }
+    return 1;
+}
+
+// Old behavior: error leaves parser through exception which gets caught by connection
+static size_t Exception(Protocol::Parser &parser) {
+    try {
+        if (parser.Failed()) {
+            throw std::runtime_error(std::string("Unknown command name: ") + parser.Name());
+        }
+    } catch (std::runtime_error &ex) {
+        std::string out(ex.what());
+    }
+    return 1;
+}
+
+// Replays pipelined input arriving in 4K reads through the connection read loop and reports how many
+// commands per second could be handled. Old loop moves the unprocessed tail to the front of the buffer after
+// every command, new one moves cursor over the buffer and compacts only once there is no room to read into
+static void Pipeline(const std::string &title, const std::string &request, size_t requests, bool in_place) {
+    std::string input;
+    input.reserve(request.size() * requests);
+    for (size_t i = 0; i < requests; i++) {
+        input.append(request);
+    }
+
+    Backend::SimpleLRU storage;
+    Network::CommandStream stream(storage);
+    Execute::Response output;
+    size_t handled = 0;
+    char buffer[4096];
+    size_t begin = 0, end = 0, offset = 0;
+
+    // Commands are only counted, it is the read loop which is measured here rather than storage
+    auto execute = [&handled](Execute::Command &, std::string &, Execute::Response &) { handled++; };
+
+    auto start = std::chrono::steady_clock::now();
+    while (offset < input.size()) {
+        if (in_place && end == sizeof(buffer) && begin > 0) {
+            std::memmove(buffer, buffer + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        size_t bytes = std::min(sizeof(buffer) - end, input.size() - offset);
+        std::memcpy(buffer + end, input.data() + offset, bytes);
+        offset += bytes;
+        end += bytes;
+
+        if (in_place) {
+            begin += stream.Process(buffer + begin, end - begin, output, execute);
+        } else {
+            // Old loop takes a single command at a time
+            for (;;) {
+                bool first = true;
+                size_t consumed = stream.Process(buffer, end, output, execute, [&first]() {
+                    bool more = first;
+                    first = false;
+                    return more;
+                });
+                if (consumed == 0) {
+                    break;
+                }
+                std::memmove(buffer, buffer + consumed, end - consumed);
+                end -= consumed;
+            }
+        }
+        if (begin == end) {
+            begin = end = 0;
+        }
+        output.Clear();
+    }
+    auto finish = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
+    std::cout << title << ": " << handled << " commands in " << seconds << "s, " << (handled / seconds / 1e6)
+              << " Mcommands/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    size_t lines = 1000000;
+    if (argc > 1) {
+        lines = std::strtoul(argv[1], nullptr, 10);
+    }
+
+    Run("valid get, build           ", "get foo bar\r\n", lines, Build);
+    Run("valid set, build           ", "set foo 0 0 6\r\n", lines, Build);
+    Run("valid append, build        ", "append foo 0 0 6\r\n", lines, Build);
+    Run("unknown command, error code", "bogus foo bar\r\n", lines, ErrorCode);
+    Run("unknown command, exception ", "bogus foo bar\r\n", lines, Exception);
+    Run("bad format, error code     ", "set foo bar 0 6\r\n", lines, ErrorCode);
+    Run("bad format, exception      ", "set foo bar 0 6\r\n", lines, Exception);
+
+    Pipeline("pipelined get, memmove    ", "get foo\r\n", lines, false);
+    Pipeline("pipelined get, in place   ", "get foo\r\n", lines, true);
+    Pipeline("pipelined set, memmove    ", "set foo 0 0 6\r\nfoobar\r\n", lines, false);
+    Pipeline("pipelined set, in place   ", "set foo 0 0 6\r\nfoobar\r\n", lines, true);
+    return 0;
+}
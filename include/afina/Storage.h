@@ -1,6 +1,10 @@
 #ifndef AFINA_STORAGE_H
 #define AFINA_STORAGE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <string>
 
 namespace Afina {
@@ -16,6 +20,12 @@ public:
     virtual void Start() {}
     virtual void Stop() {}
 
+    /**
+     * Size of the largest value storage is able to keep, no matter how much is stored already. Network
+     * rejects commands carrying larger ones before their data is read
+     */
+    virtual std::size_t MaxValueSize() const { return std::numeric_limits<std::size_t>::max(); }
+
     /**
      * Stores association between given key/value pair.
      * If key is already present in storage then replace existing value by
@@ -30,6 +40,18 @@ public:
      */
     virtual bool Put(const std::string &key, const std::string &value) = 0;
 
+    /**
+     * Same as above, but storage is allowed to take value buffer over instead of copying it, so that
+     * large value read from the network gets stored without any copy. Once method returns value is
+     * left in valid but unspecified state
+     *
+     * @param key to be associated with value
+     * @param value to be assigned for the key
+     */
+    virtual bool Put(const std::string &key, std::string &&value) {
+        return Put(key, static_cast<const std::string &>(value));
+    }
+
     /**
      * Stores association between given key/value pair if key isn't present in
      * storage.
@@ -56,6 +78,34 @@ public:
      */
     virtual bool Set(const std::string &key, const std::string &value) = 0;
 
+    /**
+     * Updates value associated with the given key in place, doing key lookup only once.
+     * If requested key doesn't present in storage method returns false and
+     * doesn't call updater.
+     *
+     * If given key found then updater gets called with the current value. Updater could
+     * modify value in place and returns true to let storage know that new value must be
+     * stored. If updater returns false it must not change the value, in a such case
+     * method returns false as well.
+     *
+     * Whole operation is atomic: no other call could see or change value in between of
+     * lookup and update.
+     *
+     * @param key to update value for
+     * @param updater function to be called with the current value
+     */
+    virtual bool Update(const std::string &key, const std::function<bool(std::string &value)> &updater) = 0;
+
+    /**
+     * Same as above, but updater also gets version of the current value, see Get. Updater which decides
+     * on version alone lets client to change value only if nobody has changed it since client has seen it
+     *
+     * @param key to update value for
+     * @param updater function to be called with the current value and its version
+     */
+    virtual bool Update(const std::string &key,
+                        const std::function<bool(std::string &value, uint64_t version)> &updater) = 0;
+
     /**
      * Removes association for the given key
      * If requested key doesn't present in storage method returns false and
@@ -84,6 +134,17 @@ public:
      * @param value output parameter to copy value to
      */
     virtual bool Get(const std::string &key, std::string &value) = 0;
+
+    /**
+     * Same as above, but also reports version of the value. Every write of the key gives value a new version
+     * which has never been used before, so the same version means value hasn't been touched in between even
+     * if it has got the same data back
+     *
+     * @param key to retrive value for
+     * @param value output parameter to copy value to
+     * @param version output parameter to store version of the value to
+     */
+    virtual bool Get(const std::string &key, std::string &value, uint64_t &version) = 0;
 };
 
 } // namespace Afina
@@ -2,6 +2,7 @@
 #define AFINA_COROUTINE_ENGINE_H
 
 #include <cstdint>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <setjmp.h>
@@ -13,6 +14,9 @@ namespace Coroutine {
 /**
  * # Entry point of coroutine library
  * Allows to run coroutine and schedule its execution. Not threadsafe
+ *
+ * All routines run on the same stack memory, which is copied aside on switch, so data shared between
+ * routines must live outside of their stacks
  */
 class Engine final {
 private:
@@ -37,6 +41,9 @@ private:
         // To include routine in the different lists, such as "alive", "blocked", e.t.c
         struct context *prev = nullptr;
         struct context *next = nullptr;
+
+        // Routine is in "blocked" list and can't be scheduled until unblocked
+        bool is_blocked = false;
     } context;
 
     /**
@@ -54,11 +61,21 @@ private:
      */
     context *alive;
 
+    /**
+     * List of routines waiting for something, they are not scheduled until unblocked
+     */
+    context *blocked;
+
     /**
      * Context to be returned finally
      */
     context *idle_ctx;
 
+    /**
+     * Called once there is nothing to run but blocked routines, expected to wait for events and unblock some
+     */
+    std::function<void()> _unblocker;
+
 protected:
     /**
      * Save stack of the current coroutine in the given context
@@ -73,10 +90,18 @@ protected:
     /**
      * Suspend current coroutine execution and execute given context
      */
-    // void Enter(context& ctx);
+    void Enter(context &ctx);
+
+    /**
+     * Move routine from one list to another
+     */
+    static void Unlink(context *&head, context *ctx);
+    static void Link(context *&head, context *ctx);
 
 public:
-    Engine() : StackBottom(0), cur_routine(nullptr), alive(nullptr) {}
+    explicit Engine(std::function<void()> unblocker = nullptr)
+        : StackBottom(0), cur_routine(nullptr), alive(nullptr), blocked(nullptr), idle_ctx(nullptr),
+          _unblocker(std::move(unblocker)) {}
     Engine(Engine &&) = delete;
     Engine(const Engine &) = delete;
 
@@ -99,6 +124,18 @@ public:
      */
     void sched(void *routine);
 
+    /**
+     * Blocks given routine, current one if nullptr is given, so that it won't be scheduled until unblocked.
+     * Blocking current routine passes execution to some other one. If there is nothing else to run, engine
+     * calls unblocker given to constructor and waits for it to unblock somebody
+     */
+    void block(void *routine = nullptr);
+
+    /**
+     * Makes blocked routine ready to be scheduled again, does nothing if it isn't blocked
+     */
+    void unblock(void *routine);
+
     /**
      * Entry point into the engine. Prepare all internal mechanics and starts given function which is
      * considered as main.
@@ -109,7 +146,7 @@ public:
      * @param pointer to the main coroutine
      * @param arguments to be passed to the main coroutine
      */
-    template <typename... Ta> void start(void (*main)(Ta...), Ta &&... args) {
+    template <typename... Fa, typename... Ta> void start(void (*main)(Fa...), Ta &&... args) {
         // To acquire stack begin, create variable on stack and remember its address
         char StackStartsHere;
         this->StackBottom = &StackStartsHere;
@@ -127,7 +164,10 @@ public:
         }
 
         // Shutdown runtime
+        delete[] std::get<0>(idle_ctx->Stack);
         delete idle_ctx;
+        idle_ctx = nullptr;
+        cur_routine = nullptr;
         this->StackBottom = 0;
     }
 
@@ -135,7 +175,7 @@ public:
      * Register new coroutine. It won't receive control until scheduled explicitely or implicitly. In case of some
      * errors function returns -1
      */
-    template <typename... Ta> void *run(void (*func)(Ta...), Ta &&... args) {
+    template <typename... Fa, typename... Ta> void *run(void (*func)(Fa...), Ta &&... args) {
         if (this->StackBottom == 0) {
             // Engine wasn't initialized yet
             return nullptr;
@@ -158,22 +198,11 @@ public:
             // to pass control after that. We never want to go backward by stack as that would mean to go backward in
             // time. Function run() has already return once (when setjmp returns 0), so return second return from run
             // would looks a bit awkward
-            if (pc->prev != nullptr) {
-                pc->prev->next = pc->next;
-            }
-
-            if (pc->next != nullptr) {
-                pc->next->prev = pc->prev;
-            }
-
-            if (alive == cur_routine) {
-                alive = alive->next;
-            }
+            Unlink(alive, pc);
 
             // current coroutine finished, and the pointer is not relevant now
             cur_routine = nullptr;
-            pc->prev = pc->next = nullptr;
-            delete std::get<0>(pc->Stack);
+            delete[] std::get<0>(pc->Stack);
             delete pc;
 
             // We cannot return here, as this function "returned" once already, so here we must select some other
@@ -188,12 +217,7 @@ public:
         Store(*pc);
 
         // Add routine as alive double-linked list
-        pc->next = alive;
-        alive = pc;
-        if (pc->next != nullptr) {
-            pc->next->prev = pc;
-        }
-
+        Link(alive, pc);
         return pc;
     }
 };
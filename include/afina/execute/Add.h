@@ -1,10 +1,10 @@
 #ifndef AFINA_EXECUTE_ADD_H
 #define AFINA_EXECUTE_ADD_H
 
-#include <cstdint>
 #include <string>
 
-#include "InsertCommand.h"
+#include "Command.h"
+#include "Response.h"
 
 namespace Afina {
 namespace Execute {
@@ -18,12 +18,9 @@ namespace Execute {
  * - "NOT_STORED" to indicate the data was not stored, but not because of an
  * error. This normally means that the condition for the command wasn't met.
  */
-class Add : public InsertCommand {
+class Add {
 public:
-    Add(const std::string &key, uint32_t flags, int32_t expire) : InsertCommand(key, flags, expire) {}
-    ~Add() {}
-
-    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+    static void Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out);
 };
 
 } // namespace Execute
@@ -0,0 +1,34 @@
+#ifndef AFINA_EXECUTE_CAS_H
+#define AFINA_EXECUTE_CAS_H
+
+#include <string>
+
+#include "Command.h"
+#include "Response.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Check and set
+ * Store data for the key, but only if nobody else has changed it since client
+ * got it last time by "gets" command
+ *
+ * Unique value for the item is its version in storage, which changes on every
+ * write, so item which was changed and then got its old data back is considered
+ * as changed as well
+ *
+ * Command must write result to the output, which could be:
+ * - "STORED", to indicate success.
+ * - "EXISTS" to indicate that the item has been modified since client fetched it
+ * - "NOT_FOUND" to indicate that the item doesn't exist
+ */
+class Cas {
+public:
+    static void Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out);
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_CAS_H
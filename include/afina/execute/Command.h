@@ -1,7 +1,9 @@
 #ifndef AFINA_EXECUTE_COMMAND_H
 #define AFINA_EXECUTE_COMMAND_H
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace Afina {
 
@@ -9,16 +11,76 @@ class Storage;
 
 namespace Execute {
 
+class Response;
+
 /**
+ * # Command to be executed over storage
+ * Value type describing single request parsed out from the network stream. Connection keeps one
+ * instance and reuses it for each request, so that buffers allocated for keys once get reused later.
  *
- *
+ * Execution is dispatched by command type to the specific implementation, see Set, Get, e.t.c
  */
 class Command {
 public:
-    Command() {}
-    virtual ~Command() {}
+    // Note: commands with data block must be kept between kSet and kCas, see HasBody
+    enum class Type : uint8_t { kNone, kSet, kAdd, kAppend, kPrepend, kReplace, kCas, kGet, kGets, kStats };
+
+    Command() : _type(Type::kNone), _nkeys(0), _flags(0), _expire(0), _cas(0) {}
+    ~Command() {}
+
+    /**
+     * Turns this instance into command of the given type. Keys are exchanged with the given vector,
+     * so both sides keeps buffers allocated before and no memory gets copied. Only first nkeys
+     * elements of the vector are meaningful
+     */
+    void Assign(Type type, std::vector<std::string> &keys, size_t nkeys, uint32_t flags, int32_t expire,
+                uint64_t cas = 0);
+
+    /**
+     * Drop command, but keep all allocated buffers for the next one
+     */
+    inline void Reset() {
+        _type = Type::kNone;
+        _nkeys = 0;
+    }
+
+    /**
+     * Execute command over the given storage
+     *
+     * @param storage to run command on
+     * @param args data block arrived with the command, if any
+     * @param out buffer to append command response to
+     */
+    void Execute(Storage &storage, const std::string &args, Response &out) const;
+
+    /**
+     * Same as above, but commands storing data block as is are allowed to hand it over to the storage
+     * instead of copying. Once method returns args is left in valid but unspecified state
+     */
+    void Execute(Storage &storage, std::string &&args, Response &out) const;
+
+    /**
+     * Returns true if command has a data block which follows command line
+     */
+    inline bool HasBody() const { return _type >= Type::kSet && _type <= Type::kCas; }
+
+    inline explicit operator bool() const { return _type != Type::kNone; }
+
+    inline Type type() const { return _type; }
+    inline const std::string &key() const { return _keys[0]; }
+    inline const std::string &key(size_t i) const { return _keys[i]; }
+    inline size_t nkeys() const { return _nkeys; }
+    inline uint32_t flags() const { return _flags; }
+    inline int32_t expire() const { return _expire; }
+    inline uint64_t cas() const { return _cas; }
 
-    virtual void Execute(Storage &storage, const std::string &args, std::string &out) = 0;
+private:
+    Type _type;
+    std::vector<std::string> _keys;
+    size_t _nkeys;
+    uint32_t _flags;
+    int32_t _expire;
+    uint64_t _cas;
 };
 
 } // namespace Execute
@@ -1,7 +1,10 @@
 #ifndef AFINA_EXECUTE_DELETE_H
 #define AFINA_EXECUTE_DELETE_H
 
+#include <string>
+
 #include "Command.h"
+#include "Response.h"
 
 namespace Afina {
 namespace Execute {
@@ -15,12 +18,9 @@ namespace Execute {
  * - "DELETED" to indicate success
  * - "NOT_FOUND" to indicate that the item with this key was not found
  */
-class Delete : public Command {
+class Delete {
 public:
-    Delete();
-    ~Delete();
-
-    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+    static void Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out);
 };
 
 } // namespace Execute
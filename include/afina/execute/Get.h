@@ -2,9 +2,9 @@
 #define AFINA_EXECUTE_GET_H
 
 #include <string>
-#include <vector>
 
 #include "Command.h"
+#include "Response.h"
 
 namespace Afina {
 namespace Execute {
@@ -31,18 +31,12 @@ namespace Execute {
  * hold items with such keys (because they were never stored, or stored
  * but deleted to make space for more items, or expired, or explicitly
  * deleted by a client).
+ *
+ * Command "gets" also sends cas unique value of each item after <bytes>, see Cas
  */
-class Get : public Command {
+class Get {
 public:
-    Get(const std::vector<std::string> &keys) : _keys(keys) {}
-    ~Get() {}
-
-    inline const std::vector<std::string> &keys() const { return _keys; }
-
-    void Execute(Storage &storage, const std::string &args, std::string &out) override;
-
-private:
-    std::vector<std::string> _keys;
+    static void Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out);
 };
 
 } // namespace Execute
@@ -0,0 +1,131 @@
+#ifndef AFINA_EXECUTE_RESPONSE_H
+#define AFINA_EXECUTE_RESPONSE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Output buffer of the connection
+ * Collects responses of executed commands until network layer sends them. Protocol lines are formatted
+ * into a single text buffer, while value bodies are kept in separate slots, so that once copied out of
+ * the storage they never get copied again: pending data is sent by a single writev with iovec pointing
+ * into those buffers.
+ *
+ * Connection keeps one instance for its whole lifetime, so buffers allocated once get reused
+ */
+class Response {
+public:
+    // Slots bigger than that are released once response is sent, to not pin memory by idle connection
+    static const size_t MAX_KEPT_VALUE_SIZE = 64 * 1024;
+
+    Response() : _nvalues(0), _first(0), _pending(0) {}
+    ~Response() {}
+
+    /**
+     * Append protocol text to the response
+     */
+    void Append(const char *data, size_t size);
+    inline void Append(const char *str) { Append(str, std::strlen(str)); }
+    inline void Append(const std::string &str) { Append(str.data(), str.size()); }
+
+    /**
+     * Append decimal representation of the given number
+     */
+    void AppendNumber(uint64_t value);
+
+    /**
+     * Returns empty buffer value could be written to. Buffer doesn't become a part of the response
+     * until CommitValue gets called, so it could be dropped, for example if value not found
+     */
+    std::string &ValueBuffer();
+
+    /**
+     * Append buffer returned by the last ValueBuffer call to the response
+     */
+    void CommitValue();
+
+    /**
+     * Fills given iovec array with pending data. Returns number of used entries
+     */
+    size_t Prepare(struct iovec *iov, size_t iovcnt) const;
+
+    /**
+     * Same as above, but skips offset bytes of pending data. Lets data be sent without consuming it, so that
+     * buffers stay intact while kernel still refers to them, see vmsplice
+     */
+    size_t Prepare(struct iovec *iov, size_t iovcnt, size_t offset) const;
+
+    /**
+     * Marks given number of bytes from the beginning of pending data as sent
+     */
+    void Consume(size_t bytes);
+
+    /**
+     * Drop all pending data, but keep buffers for later use
+     */
+    void Clear();
+
+    /**
+     * Returns copy of all pending data as a single string
+     */
+    std::string Dump() const;
+
+    /**
+     * Exchange content and buffers with other response
+     */
+    void Swap(Response &other);
+
+    /**
+     * Move pending data of other response to the end of this one, leaving other empty. Value slots are
+     * handed over rather than copied, so response built elsewhere, e.g. on another thread, gets queued
+     * for sending at the cost of its protocol text only
+     */
+    void Splice(Response &other);
+
+    inline bool Empty() const { return _pending == 0; }
+
+    // Number of bytes waiting to be sent
+    inline size_t Size() const { return _pending; }
+
+private:
+    // Part of the response, either range in text buffer or value slot
+    struct Segment {
+        // -1 for the text buffer, index of value slot otherwise
+        int32_t value;
+
+        // Range of bytes, not sent yet
+        size_t begin;
+        size_t end;
+    };
+
+    /**
+     * Move sent segments out so that buffers don't grow while connection keeps sending
+     */
+    void Compact();
+
+    // Protocol text for all segments
+    std::string _text;
+
+    // Value slots, only first _nvalues are used by the current response
+    std::vector<std::string> _values;
+    size_t _nvalues;
+
+    // Response parts, in order they must be sent. First _first are sent already
+    std::vector<Segment> _segments;
+    size_t _first;
+
+    // Number of bytes waiting to be sent
+    size_t _pending;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_RESPONSE_H
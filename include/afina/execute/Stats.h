@@ -1,18 +1,25 @@
 #ifndef AFINA_EXECUTE_STATS_H
 #define AFINA_EXECUTE_STATS_H
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 #include "Command.h"
+#include "Response.h"
 
 namespace Afina {
 namespace Execute {
 
-class Stats : public Command {
+class Stats {
 public:
-    Stats() {}
-    ~Stats() {}
-    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+    static void Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out);
+
+    /**
+     * Process wide counter reported by stats command as "STAT <name> <value>". Counter is created on the
+     * first use and lives forever, so services could keep the reference and update it without any lookup
+     */
+    static std::atomic<int64_t> &Counter(const std::string &name);
 };
 
 } // namespace Execute
@@ -0,0 +1,173 @@
+#ifndef AFINA_NETWORK_CONFIG_H
+#define AFINA_NETWORK_CONFIG_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * # Network service configuration
+ * Tunables of the network layer. Each network type reads only options it supports and silently
+ * ignores the rest
+ */
+class Config {
+public:
+    Config()
+        : reuseport(false), balance(false), edge_triggered(false), read_budget(64 * 1024),
+          output_high_watermark(1024 * 1024), output_low_watermark(256 * 1024), output_limit(256 * 1024 * 1024),
+          idle_timeout(5000), unix_only(false), busy_poll(0), socket_busy_poll(0),
+          park_idle(false), offload_threads(0), offload_keys(32), offload_bytes(256 * 1024),
+          admission_target(0), admission_interval(100) {}
+
+    /*
+     * Every worker opens its own listening socket with SO_REUSEPORT and serves accepted connections
+     * in a private epoll instance for their whole lifetime
+     * Types: mt_nonblock
+     */
+    bool reuseport;
+
+    /*
+     * Workers owning their connections measure load and move connections from the most loaded worker to
+     * the least loaded one, so skew of the accept distribution doesn't last until clients reconnect. Requires
+     * reuseport, other servers refuse to start with it
+     * Types: mt_nonblock with reuseport
+     */
+    bool balance;
+
+    /*
+     * Register connections in epoll as edge triggered: once woken up, connection reads and executes commands
+     * until socket is drained, instead of doing a single read per wakeup
+     * Types: st_nonblock, mt_nonblock
+     */
+    bool edge_triggered;
+
+    /*
+     * Max number of bytes connection reads per wakeup in edge triggered mode. Connection which has more
+     * data is served again after others got their turn
+     * Types: st_nonblock, mt_nonblock
+     */
+    std::size_t read_budget;
+
+    /*
+     * Connection stops reading and executing commands once it has that many bytes of responses not sent yet,
+     * so slow reader doesn't make server to buffer everything it asks for. Reading resumes once client takes
+     * responses and there is less than low watermark left
+     * Types: st_nonblock, mt_nonblock, io_uring
+     */
+    std::size_t output_high_watermark;
+    std::size_t output_low_watermark;
+
+    /*
+     * Max total size of responses not sent yet in all connections, 0 for no limit. Once it is exceeded,
+     * connections having something to send stop reading until it is sent
+     * Types: st_nonblock, mt_nonblock, io_uring
+     */
+    std::size_t output_limit;
+
+    /*
+     * Connection which has no activity for that many milliseconds gets closed, 0 to keep connections forever.
+     * Shared epoll mt_nonblock server has acceptors shut idle connections down, workers close them then
+     * Types: st_block, mt_block, st_nonblock, mt_nonblock
+     */
+    std::size_t idle_timeout;
+
+    /*
+     * Listening sockets handed over by the previous instance of the server on restart. Server takes ones of
+     * the right address family instead of opening new ones while there are any left, so the port never stops
+     * accepting
+     * Types: st_nonblock, mt_nonblock, st_coroutine, io_uring
+     */
+    std::vector<int> listen_sockets;
+
+    /*
+     * Path of unix domain stream socket to accept connections on in addition to TCP port, empty to not listen
+     * on it. Stale socket file left by previous run is replaced
+     * Types: st_block, mt_block, st_nonblock, mt_nonblock, st_coroutine
+     */
+    std::string unix_socket;
+
+    /*
+     * Listen only on unix_socket, don't open TCP port at all
+     * Types: st_block, mt_block, st_nonblock, mt_nonblock, st_coroutine
+     */
+    bool unix_only;
+
+    /*
+     * Paths of named pipes to read commands from and write responses to, empty to not use them. Missing pipes
+     * are created. Write pipe could be left empty to drop responses
+     * Types: st_nonblock
+     */
+    std::string read_fifo;
+    std::string write_fifo;
+
+    /*
+     * Microseconds worker keeps polling epoll without sleeping after the last event, 0 to sleep right away.
+     * Trades a core per worker for wakeup latency while there is traffic, idle worker sleeps as usual.
+     * io_uring workers peek at completion queue the same way
+     * Types: mt_nonblock, io_uring
+     */
+    std::size_t busy_poll;
+
+    /*
+     * SO_BUSY_POLL value for accepted sockets in microseconds, 0 to leave the system default. Values above
+     * net.core.busy_read require CAP_NET_ADMIN
+     * Types: mt_nonblock
+     */
+    std::size_t socket_busy_poll;
+
+    /*
+     * Connection takes a thread from the pool only once it has something to read, idle connections wait
+     * in epoll of the acceptor. Commands are still read and executed the blocking way. Other servers refuse
+     * to start with it
+     * Types: mt_block
+     */
+    bool park_idle;
+
+    /*
+     * Number of threads heavy commands are executed by, 0 to execute everything on IO thread. Command is heavy
+     * once it has at least offload_keys keys or data block of at least offload_bytes. Connection executes no
+     * more commands until its heavy one is done, so responses keep request order. Requires thread safe storage,
+     * other servers refuse to start with it
+     * Types: st_nonblock, st_coroutine
+     */
+    std::size_t offload_threads;
+    std::size_t offload_keys;
+    std::size_t offload_bytes;
+
+    /*
+     * Queueing delay in microseconds worker keeps under control, 0 to serve everything no matter how long it
+     * waits. Once delay of the worker has stayed above target for admission_interval milliseconds, worker
+     * sheds some of its rounds: commands are answered with busy error and, with reuseport, new connections are
+     * left in the listen queue, more often while delay doesn't go down. Shared acceptors never shed. Other
+     * servers refuse to start with it, see network/Admission.h
+     * Types: mt_nonblock
+     */
+    std::size_t admission_target;
+    std::size_t admission_interval;
+
+    /**
+     * Takes the next inherited listening socket of the given address family, -1 if there are none left
+     */
+    int TakeListenSocket(int family = AF_INET) {
+        for (auto it = listen_sockets.begin(); it != listen_sockets.end(); it++) {
+            int domain = 0;
+            socklen_t len = sizeof(domain);
+            if (getsockopt(*it, SOL_SOCKET, SO_DOMAIN, &domain, &len) == 0 && domain == family) {
+                int fd = *it;
+                listen_sockets.erase(it);
+                return fd;
+            }
+        }
+        return -1;
+    }
+};
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_CONFIG_H
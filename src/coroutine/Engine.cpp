@@ -1,5 +1,6 @@
 #include <afina/coroutine/Engine.h>
 
+#include <alloca.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <string.h>
@@ -7,13 +8,152 @@
 namespace Afina {
 namespace Coroutine {
 
-void Engine::Store(context &ctx) {}
+void Engine::Store(context &ctx) {
+    // Everything between the current frame and the beginning of coroutines stack belongs to the routine
+    char StackEndsHere;
+    if (&StackEndsHere < StackBottom) {
+        ctx.Low = &StackEndsHere;
+        ctx.Hight = StackBottom;
+    } else {
+        ctx.Low = StackBottom;
+        ctx.Hight = &StackEndsHere;
+    }
 
-void Engine::Restore(context &ctx) {}
+    // Keep buffer between switches, most of the time stack depth doesn't change much
+    uint32_t size = ctx.Hight - ctx.Low;
+    char *&buffer = std::get<0>(ctx.Stack);
+    uint32_t &capacity = std::get<1>(ctx.Stack);
+    if (capacity < size) {
+        delete[] buffer;
+        buffer = new char[size];
+        capacity = size;
+    }
+    memcpy(buffer, ctx.Low, size);
+}
 
-void Engine::yield() {}
+// Copies saved stack back in place and jumps into it. Kept out of line and never returning, so its frame is
+// always placed where the caller has left it rather than merged into frame of the caller
+static void __attribute__((noinline, noreturn))
+restore_stack(char *low, char *high, const char *saved, jmp_buf environment) {
+    memcpy(low, saved, high - low);
+    longjmp(environment, 1);
+}
 
-void Engine::sched(void *routine_) {}
+void Engine::Restore(context &ctx) {
+    // Stack to be restored overlaps frame of this function, which would be overwritten right under our feet.
+    // Grow stack first, so that frame doing the copy runs beyond the restored region
+    char StackEndsHere;
+    if (ctx.Low <= &StackEndsHere && &StackEndsHere <= ctx.Hight) {
+        volatile char *pad = static_cast<char *>(alloca(ctx.Hight - ctx.Low + 1));
+        pad[0] = 0;
+    }
+
+    cur_routine = &ctx;
+    restore_stack(ctx.Low, ctx.Hight, std::get<0>(ctx.Stack), ctx.Environment);
+}
+
+void Engine::Enter(context &ctx) {
+    // Idle context is never resumed from the middle, it always starts over from the point saved in start()
+    if (cur_routine != nullptr && cur_routine != idle_ctx) {
+        if (setjmp(cur_routine->Environment) > 0) {
+            return;
+        }
+        Store(*cur_routine);
+    }
+    Restore(ctx);
+}
+
+void Engine::yield() {
+    for (;;) {
+        context *next = alive;
+        while (next != nullptr && next == cur_routine) {
+            next = next->next;
+        }
+        if (next != nullptr) {
+            Enter(*next);
+            return;
+        }
+
+        // Nobody else is ready, current routine just goes on
+        bool is_routine = cur_routine != nullptr && cur_routine != idle_ctx;
+        if (is_routine && !cur_routine->is_blocked) {
+            return;
+        }
+
+        // Nothing left to run, engine is done
+        if (blocked == nullptr) {
+            return;
+        }
+
+        // Nobody is going to wake blocked routines up, give control back to start() which leaves them as is
+        if (!_unblocker) {
+            if (is_routine) {
+                Enter(*idle_ctx);
+            }
+            return;
+        }
+        _unblocker();
+    }
+}
+
+void Engine::sched(void *routine_) {
+    context *ctx = static_cast<context *>(routine_);
+    if (ctx == nullptr) {
+        yield();
+    } else if (ctx != cur_routine && !ctx->is_blocked) {
+        Enter(*ctx);
+    }
+}
+
+void Engine::block(void *routine_) {
+    context *ctx = static_cast<context *>(routine_);
+    if (ctx == nullptr) {
+        ctx = cur_routine;
+    }
+    if (ctx == nullptr || ctx == idle_ctx || ctx->is_blocked) {
+        return;
+    }
+
+    Unlink(alive, ctx);
+    Link(blocked, ctx);
+    ctx->is_blocked = true;
+    if (ctx == cur_routine) {
+        yield();
+    }
+}
+
+void Engine::unblock(void *routine_) {
+    context *ctx = static_cast<context *>(routine_);
+    if (ctx == nullptr || !ctx->is_blocked) {
+        return;
+    }
+
+    Unlink(blocked, ctx);
+    Link(alive, ctx);
+    ctx->is_blocked = false;
+}
+
+void Engine::Unlink(context *&head, context *ctx) {
+    if (ctx->prev != nullptr) {
+        ctx->prev->next = ctx->next;
+    }
+    if (ctx->next != nullptr) {
+        ctx->next->prev = ctx->prev;
+    }
+    if (head == ctx) {
+        head = ctx->next;
+    }
+    ctx->prev = ctx->next = nullptr;
+}
+
+void Engine::Link(context *&head, context *ctx) {
+    ctx->prev = nullptr;
+    ctx->next = head;
+    if (head != nullptr) {
+        head->prev = ctx;
+    }
+    head = ctx;
+}
 
 } // namespace Coroutine
 } // namespace Afina
@@ -1,22 +1,16 @@
 #include <afina/Storage.h>
 #include <afina/execute/Append.h>
 
-#include <iostream>
-
 namespace Afina {
 namespace Execute {
 
 // memcached protocol: "append" means "add this data to an existing key after existing data".
-void Append::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Append(" << _key << ")" << args << std::endl;
-    std::string value;
-    if (!storage.Get(_key, value)) {
-        out.assign("NOT_STORED");
-        return;
-    }
-    value.erase(value.end() - 2, value.end());
-    storage.Put(_key, value + args);
-    out.assign("STORED");
+void Append::Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out) {
+    bool stored = storage.Update(cmd.key(), [&args](std::string &value) {
+        value.append(args);
+        return true;
+    });
+    out.Append(stored ? "STORED\r\n" : "NOT_STORED\r\n");
 }
 
 } // namespace Execute
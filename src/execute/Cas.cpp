@@ -0,0 +1,34 @@
+#include <afina/Storage.h>
+#include <afina/execute/Cas.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "cas" is a check and set operation which means "store this data but
+// only if no one else has updated since I last fetched it."
+void Cas::Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out) {
+    bool exists = false, matched = false;
+    bool stored = storage.Update(cmd.key(), [&args, &cmd, &exists, &matched](std::string &value, uint64_t version) {
+        exists = true;
+        if (version != cmd.cas()) {
+            return false;
+        }
+        matched = true;
+        value.assign(args);
+        return true;
+    });
+
+    if (stored) {
+        out.Append("STORED\r\n");
+    } else if (matched) {
+        // New value doesn't fit into storage
+        out.Append("NOT_STORED\r\n");
+    } else if (exists) {
+        out.Append("EXISTS\r\n");
+    } else {
+        out.Append("NOT_FOUND\r\n");
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1 +1,70 @@
 #include <afina/execute/Command.h>
+
+#include <afina/execute/Add.h>
+#include <afina/execute/Append.h>
+#include <afina/execute/Cas.h>
+#include <afina/execute/Get.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
+#include <afina/execute/Response.h>
+#include <afina/execute/Set.h>
+#include <afina/execute/Stats.h>
+
+namespace Afina {
+namespace Execute {
+
+// See Command.h
+void Command::Assign(Type type, std::vector<std::string> &keys, size_t nkeys, uint32_t flags, int32_t expire,
+                     uint64_t cas) {
+    _type = type;
+    _keys.swap(keys);
+    _nkeys = nkeys;
+    _flags = flags;
+    _expire = expire;
+    _cas = cas;
+}
+
+// See Command.h
+void Command::Execute(Storage &storage, const std::string &args, Response &out) const {
+    switch (_type) {
+    case Type::kSet:
+        Set::Execute(storage, *this, args, out);
+        break;
+    case Type::kAdd:
+        Add::Execute(storage, *this, args, out);
+        break;
+    case Type::kAppend:
+        Append::Execute(storage, *this, args, out);
+        break;
+    case Type::kPrepend:
+        Prepend::Execute(storage, *this, args, out);
+        break;
+    case Type::kReplace:
+        Replace::Execute(storage, *this, args, out);
+        break;
+    case Type::kCas:
+        Cas::Execute(storage, *this, args, out);
+        break;
+    case Type::kGet:
+    case Type::kGets:
+        Get::Execute(storage, *this, args, out);
+        break;
+    case Type::kStats:
+        Stats::Execute(storage, *this, args, out);
+        break;
+    default:
+        out.Append("ERROR\r\n");
+    }
+}
+
+// See Command.h
+void Command::Execute(Storage &storage, std::string &&args, Response &out) const {
+    if (_type == Type::kSet) {
+        Set::Execute(storage, *this, std::move(args), out);
+    } else {
+        Execute(storage, static_cast<const std::string &>(args), out);
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1,10 +1,6 @@
 #include <afina/Storage.h>
 #include <afina/execute/Get.h>
 
-#include <iostream>
-#include <iterator>
-#include <sstream>
-
 namespace Afina {
 namespace Execute {
 
@@ -12,7 +8,7 @@ namespace Execute {
 
 Each item sent by the server looks like this:
 
-VALUE <key> <flags> <bytes>\r\n
+VALUE <key> <flags> <bytes> [<cas unique>]\r\n
 <data block>\r\n
 
 After all the items have been transmitted, the server sends the string
@@ -21,26 +17,30 @@ to indicate the end of response.
 
 */
 
-void Get::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::stringstream keyStream;
-    copy(_keys.begin(), _keys.end(), std::ostream_iterator<std::string>(keyStream, " "));
-    std::cout << "Get(" << keyStream.str() << ")" << std::endl;
-
-    std::stringstream outStream;
+void Get::Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out) {
+    for (size_t i = 0; i < cmd.nkeys(); i++) {
+        const std::string &key = cmd.key(i);
 
-    std::string value;
-    for (auto &key : _keys) {
-        if (!storage.Get(key, value))
+        // Value is copied out of storage right into the response buffer, which then gets sent as is
+        std::string &value = out.ValueBuffer();
+        uint64_t version = 0;
+        if (!storage.Get(key, value, version)) {
             continue;
-        if (value[value.size() - 1] == '\n') {
-            value.erase(value.end() - 2, value.end());
         }
-        outStream << "VALUE " << key << " 0 " << value.size() << "\r\n";
-        outStream << value << "\r\n";
-    }
-    outStream << "END"; // networking layer should add the last \r\n
 
-    out = outStream.str();
+        out.Append("VALUE ", 6);
+        out.Append(key);
+        out.Append(" 0 ", 3);
+        out.AppendNumber(value.size());
+        if (cmd.type() == Command::Type::kGets) {
+            out.Append(" ", 1);
+            out.AppendNumber(version);
+        }
+        out.Append("\r\n", 2);
+        out.CommitValue();
+        out.Append("\r\n", 2);
+    }
+    out.Append("END\r\n", 5);
 }
 
 } // namespace Execute
@@ -0,0 +1,17 @@
+#include <afina/Storage.h>
+#include <afina/execute/Prepend.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "prepend" means "add this data to an existing key before existing data".
+void Prepend::Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out) {
+    bool stored = storage.Update(cmd.key(), [&args](std::string &value) {
+        value.insert(0, args);
+        return true;
+    });
+    out.Append(stored ? "STORED\r\n" : "NOT_STORED\r\n");
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,207 @@
+#include <afina/execute/Response.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace Afina {
+namespace Execute {
+
+// See Response.h
+void Response::Append(const char *data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    // Continue last text segment if possible
+    if (_segments.size() > _first && _segments.back().value < 0 && _segments.back().end == _text.size()) {
+        _segments.back().end += size;
+    } else {
+        _segments.push_back(Segment{-1, _text.size(), _text.size() + size});
+    }
+
+    _text.append(data, size);
+    _pending += size;
+}
+
+// See Response.h
+void Response::AppendNumber(uint64_t value) {
+    char buf[20];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    do {
+        *--p = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    Append(p, end - p);
+}
+
+// See Response.h
+std::string &Response::ValueBuffer() {
+    if (_nvalues == _values.size()) {
+        _values.emplace_back();
+    }
+
+    std::string &value = _values[_nvalues];
+    value.clear();
+    return value;
+}
+
+// See Response.h
+void Response::CommitValue() {
+    size_t size = _values[_nvalues].size();
+    if (size > 0) {
+        _segments.push_back(Segment{int32_t(_nvalues), 0, size});
+        _pending += size;
+    }
+    _nvalues++;
+}
+
+// See Response.h
+size_t Response::Prepare(struct iovec *iov, size_t iovcnt) const {
+    size_t n = 0;
+    for (size_t i = _first; i < _segments.size() && n < iovcnt; i++, n++) {
+        const Segment &s = _segments[i];
+        const char *base = (s.value < 0) ? _text.data() : _values[s.value].data();
+        iov[n].iov_base = const_cast<char *>(base + s.begin);
+        iov[n].iov_len = s.end - s.begin;
+    }
+    return n;
+}
+
+// See Response.h
+size_t Response::Prepare(struct iovec *iov, size_t iovcnt, size_t offset) const {
+    size_t n = 0;
+    for (size_t i = _first; i < _segments.size() && n < iovcnt; i++) {
+        const Segment &s = _segments[i];
+        size_t size = s.end - s.begin;
+        if (offset >= size) {
+            offset -= size;
+            continue;
+        }
+
+        const char *base = (s.value < 0) ? _text.data() : _values[s.value].data();
+        iov[n].iov_base = const_cast<char *>(base + s.begin + offset);
+        iov[n].iov_len = size - offset;
+        offset = 0;
+        n++;
+    }
+    return n;
+}
+
+// See Response.h
+void Response::Consume(size_t bytes) {
+    _pending -= std::min(bytes, _pending);
+    while (bytes > 0 && _first < _segments.size()) {
+        Segment &s = _segments[_first];
+        size_t left = s.end - s.begin;
+        if (bytes < left) {
+            s.begin += bytes;
+            break;
+        }
+
+        bytes -= left;
+        _first++;
+    }
+
+    if (_pending == 0) {
+        Clear();
+    } else if (_first >= 64 && _first * 2 >= _segments.size()) {
+        Compact();
+    }
+}
+
+// See Response.h
+void Response::Clear() {
+    for (size_t i = 0; i < _nvalues; i++) {
+        if (_values[i].capacity() > MAX_KEPT_VALUE_SIZE) {
+            std::string().swap(_values[i]);
+        }
+    }
+    if (_text.capacity() > MAX_KEPT_VALUE_SIZE) {
+        std::string().swap(_text);
+    }
+
+    _text.clear();
+    _segments.clear();
+    _nvalues = 0;
+    _first = 0;
+    _pending = 0;
+}
+
+// See Response.h
+std::string Response::Dump() const {
+    std::string result;
+    result.reserve(_pending);
+    for (size_t i = _first; i < _segments.size(); i++) {
+        const Segment &s = _segments[i];
+        const std::string &buf = (s.value < 0) ? _text : _values[s.value];
+        result.append(buf, s.begin, s.end - s.begin);
+    }
+    return result;
+}
+
+// See Response.h
+void Response::Compact() {
+    // Value slots are used in order, so sent ones are always in the beginning. Rotate them to the end
+    // to keep allocated buffers
+    size_t text_begin = _text.size();
+    size_t values_sent = _nvalues;
+    for (size_t i = _first; i < _segments.size(); i++) {
+        const Segment &s = _segments[i];
+        if (s.value < 0) {
+            text_begin = std::min(text_begin, s.begin);
+        } else {
+            values_sent = std::min(values_sent, size_t(s.value));
+        }
+    }
+
+    _text.erase(0, text_begin);
+    std::rotate(_values.begin(), _values.begin() + values_sent, _values.end());
+    _nvalues -= values_sent;
+
+    _segments.erase(_segments.begin(), _segments.begin() + _first);
+    _first = 0;
+    for (auto &s : _segments) {
+        if (s.value < 0) {
+            s.begin -= text_begin;
+            s.end -= text_begin;
+        } else {
+            s.value -= values_sent;
+        }
+    }
+}
+
+// See Response.h
+void Response::Swap(Response &other) {
+    _text.swap(other._text);
+    _values.swap(other._values);
+    _segments.swap(other._segments);
+    std::swap(_nvalues, other._nvalues);
+    std::swap(_first, other._first);
+    std::swap(_pending, other._pending);
+}
+
+// See Response.h
+void Response::Splice(Response &other) {
+    if (Empty()) {
+        Clear();
+        Swap(other);
+        return;
+    }
+
+    for (size_t i = other._first; i < other._segments.size(); i++) {
+        const Segment &s = other._segments[i];
+        if (s.value < 0) {
+            Append(other._text.data() + s.begin, s.end - s.begin);
+        } else {
+            ValueBuffer().swap(other._values[s.value]);
+            _segments.push_back(Segment{int32_t(_nvalues), s.begin, s.end});
+            _pending += s.end - s.begin;
+            _nvalues++;
+        }
+    }
+    other.Clear();
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1,16 +1,19 @@
 #include <afina/Storage.h>
 #include <afina/execute/Set.h>
 
-#include <iostream>
-
 namespace Afina {
 namespace Execute {
 
 // memcached protocol: "set" means "store this data".
-void Set::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Set(" << _key << "): " << args << std::endl;
-    storage.Put(_key, args);
-    out = "STORED";
+void Set::Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out) {
+    storage.Put(cmd.key(), args);
+    out.Append("STORED\r\n");
+}
+
+// See Set.h
+void Set::Execute(Storage &storage, const Command &cmd, std::string &&args, Response &out) {
+    storage.Put(cmd.key(), std::move(args));
+    out.Append("STORED\r\n");
 }
 
 } // namespace Execute
@@ -1,14 +1,37 @@
 #include <afina/Storage.h>
 #include <afina/execute/Stats.h>
 
-#include <iostream>
-#include <iterator>
-#include <sstream>
+#include <map>
+#include <mutex>
 
 namespace Afina {
 namespace Execute {
 
-void Stats::Execute(Storage &storage, const std::string &args, std::string &out) { out.assign("END"); }
+// Counters registered so far, map never moves its nodes so references stay valid
+static std::mutex counters_mutex;
+static std::map<std::string, std::atomic<int64_t>> counters;
+
+void Stats::Execute(Storage &storage, const Command &cmd, const std::string &args, Response &out) {
+    std::lock_guard<std::mutex> lock(counters_mutex);
+    for (auto &counter : counters) {
+        int64_t value = counter.second.load(std::memory_order_relaxed);
+        out.Append("STAT ");
+        out.Append(counter.first);
+        out.Append(value < 0 ? " -" : " ");
+        out.AppendNumber(value < 0 ? -uint64_t(value) : uint64_t(value));
+        out.Append("\r\n");
+    }
+    out.Append("END\r\n");
+}
+
+std::atomic<int64_t> &Stats::Counter(const std::string &name) {
+    std::lock_guard<std::mutex> lock(counters_mutex);
+    auto it = counters.find(name);
+    if (it == counters.end()) {
+        it = counters.emplace(std::piecewise_construct, std::forward_as_tuple(name), std::forward_as_tuple(0)).first;
+    }
+    return it->second;
+}
 
 } // namespace Execute
 } // namespace Afina
@@ -6,25 +6,37 @@
 #include <semaphore.h>
 #include <signal.h>
 #include <thread>
+#include <unistd.h>
 
 #include <cxxopts.hpp>
 
 #include <afina/Storage.h>
 #include <afina/Version.h>
 #include <afina/logging/Service.h>
+#include <afina/network/Config.h>
 #include <afina/network/Server.h>
 
 #include "logging/ServiceImpl.h"
+#include "network/Handoff.h"
 #include "network/mt_blocking/ServerImpl.h"
+#ifdef AFINA_HAVE_IO_URING
+#include "network/io_uring/ServerImpl.h"
+#endif
 #include "network/mt_nonblocking/ServerImpl.h"
 #include "network/st_blocking/ServerImpl.h"
+#include "network/st_coroutine/ServerImpl.h"
 #include "network/st_nonblocking/ServerImpl.h"
+#include "network/udp/ServerImpl.h"
 
 #include "storage/SimpleLRU.h"
 #include "storage/ThreadSafeSimpleLRU.h"
 
 using namespace Afina;
 
+// Signal set that to notify application about time to stop
+sem_t stop_semaphore;
+volatile sig_atomic_t stop_reason = 0;
+
 /**
  * Whole application class
  */
@@ -59,22 +71,151 @@ public:
         }
 
         // Step 2: Configure network
+        netConfig.reset(new Network::Config);
+        netConfig->reuseport = options.count("reuseport") > 0;
+        netConfig->balance = options.count("balance") > 0;
+        netConfig->edge_triggered = options.count("edge-triggered") > 0;
+        if (options.count("read-budget") > 0) {
+            netConfig->read_budget = options["read-budget"].as<size_t>();
+        }
+        if (options.count("output-high-watermark") > 0) {
+            netConfig->output_high_watermark = options["output-high-watermark"].as<size_t>();
+        }
+        if (options.count("output-low-watermark") > 0) {
+            netConfig->output_low_watermark = options["output-low-watermark"].as<size_t>();
+        }
+        if (options.count("output-limit") > 0) {
+            netConfig->output_limit = options["output-limit"].as<size_t>();
+        }
+        if (options.count("idle-timeout") > 0) {
+            netConfig->idle_timeout = options["idle-timeout"].as<size_t>();
+        }
+        if (options.count("unix-socket") > 0) {
+            netConfig->unix_socket = options["unix-socket"].as<std::string>();
+        }
+        netConfig->unix_only = options.count("unix-only") > 0;
+        if (options.count("busy-poll") > 0) {
+            netConfig->busy_poll = options["busy-poll"].as<size_t>();
+        }
+        if (options.count("socket-busy-poll") > 0) {
+            netConfig->socket_busy_poll = options["socket-busy-poll"].as<size_t>();
+        }
+        netConfig->park_idle = options.count("park-idle") > 0;
+        if (options.count("offload-threads") > 0) {
+            netConfig->offload_threads = options["offload-threads"].as<size_t>();
+        }
+        if (options.count("offload-keys") > 0) {
+            netConfig->offload_keys = options["offload-keys"].as<size_t>();
+        }
+        if (options.count("offload-bytes") > 0) {
+            netConfig->offload_bytes = options["offload-bytes"].as<size_t>();
+        }
+        if (options.count("admission-target") > 0) {
+            netConfig->admission_target = options["admission-target"].as<size_t>();
+        }
+        if (options.count("admission-interval") > 0) {
+            netConfig->admission_interval = options["admission-interval"].as<size_t>();
+        }
+        if (options.count("read-fifo") > 0) {
+            netConfig->read_fifo = options["read-fifo"].as<std::string>();
+        }
+        if (options.count("write-fifo") > 0) {
+            netConfig->write_fifo = options["write-fifo"].as<std::string>();
+        }
+        if (netConfig->output_low_watermark > netConfig->output_high_watermark) {
+            throw std::runtime_error("Output low watermark must not exceed high watermark");
+        }
+        if (netConfig->unix_only && netConfig->unix_socket.empty()) {
+            throw std::runtime_error("Unix socket path is required to listen on it only");
+        }
+        if (netConfig->read_fifo.empty() && !netConfig->write_fifo.empty()) {
+            throw std::runtime_error("Responses fifo requires commands fifo");
+        }
+        if (netConfig->admission_target > 0 && netConfig->admission_interval == 0) {
+            throw std::runtime_error("Admission interval must be positive");
+        }
+
         std::string network_type = "st_block";
         if (options.count("network") > 0) {
             network_type = options["network"].as<std::string>();
         }
 
+        // Blocking servers shut listening socket down to wakeup acceptor, so it can't be shared
+        if (options.count("handoff") > 0) {
+            if (network_type == "st_block" || network_type == "mt_block") {
+                throw std::runtime_error("Listening sockets handoff isn't supported by " + network_type);
+            }
+            handoffPath = options["handoff"].as<std::string>();
+        }
+
+        // Ring workers accept on their own TCP sockets only
+        if (network_type == "io_uring" && !netConfig->unix_socket.empty()) {
+            throw std::runtime_error("Unix socket isn't supported by " + network_type);
+        }
+
+        // Pipes are served by epoll loop along with connections, which only single threaded server has
+        if (!netConfig->read_fifo.empty() && network_type != "st_nonblock") {
+            throw std::runtime_error("Fifo isn't supported by " + network_type);
+        }
+
+        // Pool wakes up the single IO thread, servers with several loops have nothing to route results through
+        if (netConfig->offload_threads > 0 && network_type != "st_nonblock" && network_type != "st_coroutine") {
+            throw std::runtime_error("Offloading commands isn't supported by " + network_type);
+        }
+
+        // Only workers with their own listening sockets and epoll instances own connections they could move
+        if (netConfig->balance && network_type != "mt_nonblock") {
+            throw std::runtime_error("Balancing connections isn't supported by " + network_type);
+        }
+        if (netConfig->balance && !netConfig->reuseport) {
+            throw std::runtime_error("Balancing connections requires --reuseport");
+        }
+
+        // Parking needs acceptor which waits for connections to get readable, only mt_block has one
+        if (netConfig->park_idle && network_type != "mt_block") {
+            throw std::runtime_error("Parking idle connections isn't supported by " + network_type);
+        }
+
+        // Delay is measured by rounds of epoll workers, the other servers have nothing to shed
+        if (netConfig->admission_target > 0 && network_type != "mt_nonblock") {
+            throw std::runtime_error("Admission control isn't supported by " + network_type);
+        }
+
         if (network_type == "st_block") {
-            server = std::make_shared<Afina::Network::STblocking::ServerImpl>(storage, logService);
+            server = std::make_shared<Afina::Network::STblocking::ServerImpl>(storage, logService, netConfig);
         } else if (network_type == "mt_block") {
-            server = std::make_shared<Afina::Network::MTblocking::ServerImpl>(storage, logService);
+            server = std::make_shared<Afina::Network::MTblocking::ServerImpl>(storage, logService, netConfig);
         } else if (network_type == "st_nonblock") {
-            server = std::make_shared<Afina::Network::STnonblock::ServerImpl>(storage, logService);
+            server = std::make_shared<Afina::Network::STnonblock::ServerImpl>(storage, logService, netConfig);
         } else if (network_type == "mt_nonblock") {
-            server = std::make_shared<Afina::Network::MTnonblock::ServerImpl>(storage, logService);
+            server = std::make_shared<Afina::Network::MTnonblock::ServerImpl>(storage, logService, netConfig);
+        } else if (network_type == "st_coroutine") {
+            server = std::make_shared<Afina::Network::STcoroutine::ServerImpl>(storage, logService, netConfig);
+        } else if (network_type == "io_uring") {
+#ifdef AFINA_HAVE_IO_URING
+            server = std::make_shared<Afina::Network::IOUring::ServerImpl>(storage, logService, netConfig);
+#else
+            // Built without io_uring, use closest epoll based server
+            std::cerr << "Warning: io_uring is not supported by this build, fallback to mt_nonblock" << std::endl;
+            netConfig->reuseport = true;
+            server = std::make_shared<Afina::Network::MTnonblock::ServerImpl>(storage, logService, netConfig);
+#endif
         } else {
             throw std::runtime_error("Unknown network type");
         }
+
+        // Heavy commands are executed by pool concurrently with IO thread
+        if (netConfig->offload_threads > 0 && storage_type != "mt_lru") {
+            throw std::runtime_error("Offloading commands requires thread safe storage, use mt_lru");
+        }
+
+        // UDP workers run concurrently with TCP ones, so storage must be thread safe
+        if (options.count("udp") > 0) {
+            if (storage_type != "mt_lru") {
+                throw std::runtime_error("UDP frontend requires thread safe storage, use mt_lru");
+            }
+            udpServer = std::make_shared<Afina::Network::UDP::ServerImpl>(storage, logService, netConfig);
+        }
     }
 
     // Start services in correct order
@@ -86,18 +227,46 @@ public:
         log->warn("Start storage");
         storage->Start();
 
+        // Take listening sockets over from running instance if there is one
+        if (!handoffPath.empty()) {
+            handoff.reset(new Network::Handoff(handoffPath, logService->select("network")));
+            netConfig->listen_sockets = handoff->Receive();
+        }
+
         // TODO: configure network service
         const uint16_t port = 8080;
         log->warn("Start network on {}", port);
         server->Start(port, 2, 2);
+        if (udpServer) {
+            log->warn("Start udp network on {}", port);
+            udpServer->Start(port, 1, 2);
+        }
+
+        if (handoff) {
+            // Previous instance could have more sockets than server needs
+            for (int fd : netConfig->listen_sockets) {
+                close(fd);
+            }
+            netConfig->listen_sockets.clear();
+
+            handoff->Commit();
+            handoff->Serve(server->ListenSockets(), [] { sem_post(&stop_semaphore); });
+        }
     }
 
     // Stop services in correct order
     void Stop() {
         auto log = logService->select("root");
         log->warn("Stop application");
+        if (handoff) {
+            handoff->Stop();
+        }
         server->Stop();
         server->Join();
+        if (udpServer) {
+            udpServer->Stop();
+            udpServer->Join();
+        }
 
         storage->Stop();
         logService->Stop();
@@ -108,12 +277,16 @@ private:
     std::shared_ptr<Afina::Logging::Service> logService;
 
     std::shared_ptr<Afina::Storage> storage;
+    std::shared_ptr<Afina::Network::Config> netConfig;
     std::shared_ptr<Afina::Network::Server> server;
-};
 
-// Signal set that to notify application about time to stop
-sem_t stop_semaphore;
-volatile sig_atomic_t stop_reason = 0;
+    // Memcached UDP frontend running along with server, if enabled
+    std::shared_ptr<Afina::Network::Server> udpServer;
+
+    // Listening sockets handoff between restarts, see Network::Handoff
+    std::string handoffPath;
+    std::unique_ptr<Afina::Network::Handoff> handoff;
+};
 
 // Catch user desire to stop the server
 void on_term(int signum, siginfo_t *siginfo, void *data) {
@@ -129,6 +302,42 @@ int main(int argc, char **argv) {
         // and simplify validation below
         options.add_options()("s,storage", "Type of storage service to use", cxxopts::value<std::string>());
         options.add_options()("n,network", "Type of network service to use", cxxopts::value<std::string>());
+        options.add_options()("reuseport", "Listen on a separate SO_REUSEPORT socket in each network worker");
+        options.add_options()("balance", "Move connections from overloaded network workers, requires --reuseport");
+        options.add_options()("edge-triggered", "Use edge triggered epoll, read each socket until it is drained");
+        options.add_options()("read-budget", "Max bytes read from a connection per wakeup in edge triggered mode",
+                              cxxopts::value<size_t>());
+        options.add_options()("output-high-watermark", "Stop reading from a connection with that many bytes to send",
+                              cxxopts::value<size_t>());
+        options.add_options()("output-low-watermark", "Resume reading once a connection has less bytes to send",
+                              cxxopts::value<size_t>());
+        options.add_options()("output-limit", "Max bytes to send buffered in all connections, 0 for no limit",
+                              cxxopts::value<size_t>());
+        options.add_options()("idle-timeout", "Close connections idle for that many milliseconds, 0 to never close",
+                              cxxopts::value<size_t>());
+        options.add_options()("handoff", "Unix socket path to take listening sockets over from running instance",
+                              cxxopts::value<std::string>());
+        options.add_options()("unix-socket", "Also listen on unix domain socket at the given path",
+                              cxxopts::value<std::string>());
+        options.add_options()("unix-only", "Listen on unix domain socket only, requires --unix-socket");
+        options.add_options()("busy-poll", "Microseconds network workers spin on epoll after traffic before sleeping",
+                              cxxopts::value<size_t>());
+        options.add_options()("socket-busy-poll", "SO_BUSY_POLL microseconds for accepted sockets",
+                              cxxopts::value<size_t>());
+        options.add_options()("park-idle", "Keep idle mt_block connections in epoll instead of worker threads");
+        options.add_options()("offload-threads", "Threads executing heavy commands off the IO thread, 0 to not use",
+                              cxxopts::value<size_t>());
+        options.add_options()("offload-keys", "Number of keys which makes command heavy", cxxopts::value<size_t>());
+        options.add_options()("offload-bytes", "Data block size which makes command heavy", cxxopts::value<size_t>());
+        options.add_options()("admission-target", "Queueing delay in microseconds workers shed load above, 0 to not",
+                              cxxopts::value<size_t>());
+        options.add_options()("admission-interval", "Milliseconds delay must stay above target before shedding",
+                              cxxopts::value<size_t>());
+        options.add_options()("r,read-fifo", "Also read commands from named pipe at the given path",
+                              cxxopts::value<std::string>());
+        options.add_options()("w,write-fifo", "Write responses to commands from --read-fifo into named pipe",
+                              cxxopts::value<std::string>());
+        options.add_options()("udp", "Also serve memcached UDP protocol on the same port, requires mt_lru storage");
         options.add_options()("h,help", "Print usage info");
         options.parse(argc, argv);
 
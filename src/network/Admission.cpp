@@ -0,0 +1,82 @@
+#include "Admission.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include <afina/execute/Stats.h>
+
+namespace Afina {
+namespace Network {
+
+// Dropping which starts again that soon after the previous time keeps its pace, as in CoDel
+static const int RESUME_INTERVALS = 16;
+
+static std::atomic<int64_t> &ShedRounds() {
+    static std::atomic<int64_t> &counter = Execute::Stats::Counter("shed_rounds");
+    return counter;
+}
+
+// See Admission.h
+Admission::Admission(std::size_t target_us, std::size_t interval_ms)
+    : _target(std::chrono::microseconds(target_us)), _interval(std::chrono::milliseconds(interval_ms)),
+      _dropping(false), _count(0), _last_count(0) {}
+
+// See Admission.h
+bool Admission::Shed(clock::time_point now) {
+    if (!_dropping) {
+        return false;
+    }
+
+    // Worker had nothing to do for a while, so whatever it had queued is gone
+    if (now - _last_round >= _interval) {
+        _dropping = false;
+        _first_above = clock::time_point();
+        return false;
+    }
+
+    if (now < _drop_next) {
+        return false;
+    }
+    _count++;
+    _drop_next = ControlLaw(now);
+    ShedRounds().fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// See Admission.h
+void Admission::Observe(clock::duration delay, clock::time_point now, bool shed) {
+    _last_round = now;
+    if (shed) {
+        return;
+    }
+
+    if (delay < _target) {
+        _first_above = clock::time_point();
+        _dropping = false;
+        return;
+    }
+
+    if (_first_above == clock::time_point()) {
+        _first_above = now + _interval;
+    } else if (!_dropping && now >= _first_above) {
+        _dropping = true;
+        unsigned delta = _count - _last_count;
+        _count = 0;
+        if (delta > 1 && now - _drop_next < RESUME_INTERVALS * _interval) {
+            _count = delta;
+        }
+        _last_count = _count;
+
+        // Very next round is shed
+        _drop_next = now;
+    }
+}
+
+// See Admission.h
+Admission::clock::time_point Admission::ControlLaw(clock::time_point t) const {
+    return t + std::chrono::duration_cast<clock::duration>(_interval / std::sqrt(double(_count)));
+}
+
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,73 @@
+#ifndef AFINA_NETWORK_ADMISSION_H
+#define AFINA_NETWORK_ADMISSION_H
+
+#include <chrono>
+#include <cstddef>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * # Admission control of a single worker
+ * Worker serves ready connections in rounds, one per wakeup, so connection served at the end of the round has
+ * been waiting for about as long as the round took. That is the queueing delay worker reports after each round.
+ *
+ * Control follows CoDel: a burst is fine as long as the queue drains, so nothing happens until the delay stays
+ * above target for a whole interval. From then on worker sheds some rounds: connections served in there get
+ * their commands answered with busy error and no new connections are accepted. Shed rounds follow each other
+ * at interval / sqrt(n) for the n-th one, so shedding gets harder while delay doesn't go down. Shedding stops
+ * once a round which isn't shed takes less than target, or worker has had nothing to do for an interval.
+ *
+ * Shed rounds don't count as delay samples since they take next to nothing, see Observe(). Instance is owned
+ * by a single thread.
+ *
+ * Counters reported by stats command: shed_rounds, shed_commands answered with busy error and shed_accepts,
+ * number of times worker left its listening sockets alone
+ */
+class Admission {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * Delay target in microseconds, 0 turns control off; interval in milliseconds
+     */
+    Admission(std::size_t target_us, std::size_t interval_ms);
+
+    bool Enabled() const { return _target.count() > 0; }
+
+    /**
+     * Decides if the round started at the given moment must be shed
+     */
+    bool Shed(clock::time_point now);
+
+    /**
+     * Reports queueing delay of the round, shed one is expected to be reported too
+     */
+    void Observe(clock::duration delay, clock::time_point now, bool shed);
+
+private:
+    // Moment of the next shed round after the given one
+    clock::time_point ControlLaw(clock::time_point t) const;
+
+    clock::duration _target;
+    clock::duration _interval;
+
+    // Delay has been above target since this moment minus interval, zero while it is below
+    clock::time_point _first_above;
+
+    // Worker sheds rounds, next one starts not earlier than drop_next
+    bool _dropping;
+    clock::time_point _drop_next;
+
+    // Rounds shed since dropping started and that number at the moment it started last time
+    unsigned _count;
+    unsigned _last_count;
+
+    // Time of the last round reported
+    clock::time_point _last_round;
+};
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_ADMISSION_H
@@ -0,0 +1,38 @@
+#include "Blocking.h"
+
+#include <cstring>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+
+namespace Afina {
+namespace Network {
+
+// See Blocking.h
+bool send_response(int client_socket, Execute::Response &output, bool more) {
+    struct iovec iov[64];
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    while (!output.Empty()) {
+        msg.msg_iovlen = output.Prepare(iov, 64);
+        ssize_t sent = sendmsg(client_socket, &msg, more ? MSG_MORE : 0);
+        if (sent <= 0) {
+            return false;
+        }
+        output.Consume(sent);
+    }
+    return true;
+}
+
+// See Blocking.h
+void set_tcp_nodelay(int client_socket, const struct sockaddr_storage &client_addr) {
+    if (client_addr.ss_family == AF_INET) {
+        int opts = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &opts, sizeof(opts));
+    }
+}
+
+} // namespace Network
+} // namespace Afina
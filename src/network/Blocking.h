@@ -0,0 +1,32 @@
+#ifndef AFINA_NETWORK_BLOCKING_H
+#define AFINA_NETWORK_BLOCKING_H
+
+#include <cstddef>
+
+#include <sys/socket.h>
+
+#include <afina/execute/Response.h>
+
+namespace Afina {
+namespace Network {
+
+// Responses of a single read are sent together, unless they grow that large before the read is processed
+const std::size_t FLUSH_THRESHOLD = 64 * 1024;
+
+/**
+ * Sends all pending data of the response from blocking socket, kernel might accept only part of it at once.
+ * More tells kernel that another flush follows right away, so that it holds the last partial segment back
+ * until then. Returns false if socket is broken
+ */
+bool send_response(int client_socket, Execute::Response &output, bool more = false);
+
+/**
+ * Turns Nagle algorithm off for TCP client accepted from the given address, responses go out in a single
+ * flush per read, so there is nothing to merge them with. Other sockets are left as is
+ */
+void set_tcp_nodelay(int client_socket, const struct sockaddr_storage &client_addr);
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_BLOCKING_H
@@ -0,0 +1,139 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+#include <afina/execute/Stats.h>
+
+namespace Afina {
+namespace Network {
+
+// Memory reported by stats command, see BufferPool.h
+static std::atomic<int64_t> &AllocatedBytes() {
+    static std::atomic<int64_t> &counter = Execute::Stats::Counter("read_buffers_bytes");
+    return counter;
+}
+
+static std::atomic<int64_t> &UsedBytes() {
+    static std::atomic<int64_t> &counter = Execute::Stats::Counter("read_buffers_used_bytes");
+    return counter;
+}
+
+// See BufferPool.h
+BufferPool::BufferPool(std::size_t max_cached) : _free(nullptr), _cached(0), _max_cached(max_cached) {}
+
+// See BufferPool.h
+BufferPool::~BufferPool() {
+    while (_free != nullptr) {
+        Chunk *next = _free->next;
+        delete _free;
+        _free = next;
+    }
+    AllocatedBytes().fetch_sub(_cached * sizeof(Chunk), std::memory_order_relaxed);
+}
+
+// See BufferPool.h
+BufferPool::Chunk *BufferPool::Get() {
+    UsedBytes().fetch_add(sizeof(Chunk), std::memory_order_relaxed);
+    if (_free == nullptr) {
+        AllocatedBytes().fetch_add(sizeof(Chunk), std::memory_order_relaxed);
+        return new Chunk;
+    }
+
+    Chunk *chunk = _free;
+    _free = chunk->next;
+    _cached--;
+    return chunk;
+}
+
+// See BufferPool.h
+void BufferPool::Put(Chunk *chunk) {
+    UsedBytes().fetch_sub(sizeof(Chunk), std::memory_order_relaxed);
+    if (_cached >= _max_cached) {
+        AllocatedBytes().fetch_sub(sizeof(Chunk), std::memory_order_relaxed);
+        delete chunk;
+        return;
+    }
+
+    chunk->next = _free;
+    _free = chunk;
+    _cached++;
+}
+
+// See BufferPool.h
+BufferPool &BufferPool::Local() {
+    static thread_local BufferPool pool;
+    return pool;
+}
+
+// See BufferPool.h
+char *ReadBuffer::Space(std::size_t &size) {
+    if (_tail == nullptr || _end == BufferPool::CHUNK_SIZE) {
+        BufferPool::Chunk *chunk = BufferPool::Local().Get();
+        chunk->next = nullptr;
+        if (_tail == nullptr) {
+            _head = chunk;
+            _begin = 0;
+        } else {
+            _tail->next = chunk;
+        }
+        _tail = chunk;
+        _end = 0;
+    }
+
+    size = BufferPool::CHUNK_SIZE - _end;
+    return _tail->data + _end;
+}
+
+// See BufferPool.h
+void ReadBuffer::Commit(std::size_t bytes) {
+    assert(_tail != nullptr && _end + bytes <= BufferPool::CHUNK_SIZE);
+    _end += bytes;
+    _size += bytes;
+
+    // Nothing has been read, chunk taken for it isn't needed
+    if (_size == 0) {
+        Clear();
+    }
+}
+
+// See BufferPool.h
+const char *ReadBuffer::Data(std::size_t &size) const {
+    if (_head == nullptr) {
+        size = 0;
+        return nullptr;
+    }
+    size = std::min(_size, BufferPool::CHUNK_SIZE - _begin);
+    return _head->data + _begin;
+}
+
+// See BufferPool.h
+void ReadBuffer::Consume(std::size_t bytes) {
+    assert(bytes <= _size && _begin + bytes <= BufferPool::CHUNK_SIZE);
+    _begin += bytes;
+    _size -= bytes;
+    if (_size == 0) {
+        Clear();
+    } else if (_begin == BufferPool::CHUNK_SIZE) {
+        BufferPool::Chunk *next = _head->next;
+        BufferPool::Local().Put(_head);
+        _head = next;
+        _begin = 0;
+    }
+}
+
+// See BufferPool.h
+void ReadBuffer::Clear() {
+    while (_head != nullptr) {
+        BufferPool::Chunk *next = _head->next;
+        BufferPool::Local().Put(_head);
+        _head = next;
+    }
+    _tail = nullptr;
+    _begin = _end = _size = 0;
+}
+
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,116 @@
+#ifndef AFINA_NETWORK_BUFFER_POOL_H
+#define AFINA_NETWORK_BUFFER_POOL_H
+
+#include <cstddef>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * # Per thread pool of read buffers
+ * Connections take fixed size chunks only while they have input not processed yet and give them back once
+ * it is drained, so mostly idle connections hold no buffer memory at all. Freed chunks are kept for reuse up
+ * to the limit, the rest go back to allocator.
+ *
+ * Pool is not thread safe, each worker thread uses its own one, see Local(). Chunk could be returned to pool
+ * of other thread than it was taken from, e.g. once connection is served by other worker.
+ *
+ * Memory held by all pools is reported by stats command: read_buffers_bytes is allocated in total, including
+ * cached chunks, read_buffers_used_bytes is held by connections
+ */
+class BufferPool {
+public:
+    // Size of a single chunk, that is as much as connection reads from socket at once
+    static const std::size_t CHUNK_SIZE = 4096;
+
+    struct Chunk {
+        Chunk *next;
+        char data[CHUNK_SIZE];
+    };
+
+    explicit BufferPool(std::size_t max_cached = 256);
+    ~BufferPool();
+
+    /**
+     * Takes chunk from the pool, allocates new one if there is nothing cached
+     */
+    Chunk *Get();
+
+    /**
+     * Returns chunk to the pool
+     */
+    void Put(Chunk *chunk);
+
+    /**
+     * Pool of the calling thread
+     */
+    static BufferPool &Local();
+
+private:
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // Cached chunks linked through next
+    Chunk *_free;
+    std::size_t _cached;
+    std::size_t _max_cached;
+};
+
+/**
+ * # Connection input kept in chain of pooled chunks
+ * Data is appended to the tail chunk and consumed from the head one, parser takes it in place. Drained chunks
+ * go back to pool of the calling thread right away. Input which doesn't fit into a single chunk, e.g. once
+ * connection has stopped executing commands until client takes responses, grows by one more chunk instead
+ * of stopping reading in the middle of a command
+ */
+class ReadBuffer {
+public:
+    ReadBuffer() : _head(nullptr), _tail(nullptr), _begin(0), _end(0), _size(0) {}
+    ~ReadBuffer() { Clear(); }
+
+    /**
+     * Returns room to read data into at the end of the buffer, takes new chunk if the last one is full
+     */
+    char *Space(std::size_t &size);
+
+    /**
+     * Appends bytes written into space returned by the last call to Space()
+     */
+    void Commit(std::size_t bytes);
+
+    /**
+     * Returns contiguous block at the beginning of the buffer, there could be more after it is consumed
+     */
+    const char *Data(std::size_t &size) const;
+
+    /**
+     * Drops bytes from the beginning of the buffer, they must be available in the block returned by Data()
+     */
+    void Consume(std::size_t bytes);
+
+    /**
+     * Drops all data and returns chunks to pool
+     */
+    void Clear();
+
+    inline bool Empty() const { return _size == 0; }
+    inline std::size_t Size() const { return _size; }
+
+private:
+    ReadBuffer(const ReadBuffer &) = delete;
+    ReadBuffer &operator=(const ReadBuffer &) = delete;
+
+    // Chain of chunks, data starts at _begin in the head one and ends at _end in the tail one
+    BufferPool::Chunk *_head;
+    BufferPool::Chunk *_tail;
+    std::size_t _begin;
+    std::size_t _end;
+
+    // Number of bytes in buffer
+    std::size_t _size;
+};
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_BUFFER_POOL_H
@@ -0,0 +1,64 @@
+#include "CommandStream.h"
+
+#include <algorithm>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Network {
+
+// See CommandStream.h
+const std::size_t CommandStream::RESERVE_LIMIT;
+const std::size_t CommandStream::READ_LIMIT;
+
+// See CommandStream.h
+CommandStream::CommandStream(const Storage &storage)
+    : _max_value(storage.MaxValueSize()), _arg_remains(0), _skip(false) {}
+
+// See CommandStream.h
+void CommandStream::Reset() {
+    _command.Reset();
+    _argument.resize(0);
+    _parser.Reset();
+    _arg_remains = 0;
+    _skip = false;
+}
+
+// See CommandStream.h
+void CommandStream::Build(Execute::Response &output) {
+    if (_parser.Failed()) {
+        // Broken line has been skipped, let client know and keep going with the next one
+        _parser.BuildError(output);
+        _parser.Reset();
+        return;
+    }
+
+    _parser.Build(_arg_remains, _command);
+    if (_command.HasBody()) {
+        // Client gets error once it has sent the whole data block, so that stream stays in sync
+        _skip = _arg_remains > _max_value;
+        if (!_skip) {
+            _argument.reserve(std::min(_arg_remains + 2, RESERVE_LIMIT));
+        }
+        _arg_remains += 2;
+    }
+}
+
+// See CommandStream.h
+bool CommandStream::Complete(Execute::Response &output) {
+    if (!_command.HasBody()) {
+        return true;
+    }
+
+    // Data block must be terminated by \r\n which is not a part of the value itself
+    std::size_t arg_size = _argument.size();
+    if (arg_size >= 2 && _argument.compare(arg_size - 2, 2, "\r\n") == 0) {
+        _argument.resize(arg_size - 2);
+        return true;
+    }
+    output.Append("CLIENT_ERROR bad data chunk\r\n");
+    return false;
+}
+
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,198 @@
+#ifndef AFINA_NETWORK_COMMAND_STREAM_H
+#define AFINA_NETWORK_COMMAND_STREAM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+#include <sys/types.h>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include "protocol/Parser.h"
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Network {
+
+/**
+ * # Parse state of the client stream
+ * Single block of data read from the client could trigger inside actions a multiple times, for example:
+ * - read#0: [<command1 start>]
+ * - read#1: [<command1 end> <argument> <command2> <argument for command 2> <command3> ... ]
+ *
+ * Stream keeps whatever is parsed so far between reads: command line which hasn't been completed yet, or
+ * command with its data block being collected. Broken command lines and data blocks not terminated by \r\n
+ * are answered with errors right here, everything else is up to the server, see Process()
+ *
+ * Memory for data block is taken as it arrives rather than as much as client announces up front. Command
+ * with data block larger than storage could keep gets rejected, its data is skipped without being stored
+ */
+class CommandStream {
+public:
+    /**
+     * Data blocks larger than storage could keep are rejected, see Storage::MaxValueSize()
+     */
+    explicit CommandStream(const Storage &storage);
+
+    /**
+     * Parses commands out of the given bytes and calls execute(command, args, output) for each complete one,
+     * args is the data block without trailing \r\n. Before every new command more() is asked if server wants
+     * to go on, e.g. connection could stop once it has too many responses not sent yet.
+     *
+     * Returns number of bytes consumed, the rest must be given again once server is ready to go on. Command
+     * which has got the whole data block by ReadArgument() is executed even if there are no bytes given
+     */
+    template <typename Executor, typename Predicate>
+    std::size_t Process(const char *data, std::size_t size, Execute::Response &output, Executor &&execute,
+                        Predicate &&more);
+
+    /**
+     * Same as above for server which executes everything it gets
+     */
+    template <typename Executor>
+    std::size_t Process(const char *data, std::size_t size, Execute::Response &output, Executor &&execute) {
+        return Process(data, size, output, execute, []() { return true; });
+    }
+
+    /**
+     * Receives data block of the current command right into the argument, skipping intermediate buffer.
+     * read(buffer, size) must return the same as read(2) does, its result is returned back
+     */
+    template <typename Reader> ssize_t ReadArgument(Reader &&read);
+
+    /**
+     * Number of data block bytes the current command waits for, including trailing \r\n
+     */
+    std::size_t Remains() const { return _arg_remains; }
+
+    /**
+     * There is command parsed, but not executed yet
+     */
+    bool HasCommand() const { return bool(_command); }
+
+    /**
+     * Some part of the command has been received already
+     */
+    bool Started() const { return bool(_command) || _parser.Started(); }
+
+    /**
+     * Forget everything parsed so far, e.g. once stream is closed in the middle of command
+     */
+    void Reset();
+
+private:
+    // Memory reserved for data block once command is parsed, the rest is allocated as data arrives
+    static const std::size_t RESERVE_LIMIT = 1024 * 1024;
+
+    // Largest part of data block received by ReadArgument() at once
+    static const std::size_t READ_LIMIT = 64 * 1024;
+
+    /**
+     * Builds command once parser is done with its line, broken line gets error response
+     */
+    void Build(Execute::Response &output);
+
+    /**
+     * Checks that data block is terminated by \r\n and strips it, otherwise responds with error and returns false
+     */
+    bool Complete(Execute::Response &output);
+
+    std::size_t _max_value;
+
+    Protocol::Parser _parser;
+    std::size_t _arg_remains;
+    std::string _argument;
+    Execute::Command _command;
+
+    // Data block of the current command is too large, it is thrown away as it comes
+    bool _skip;
+};
+
+// See above
+template <typename Executor, typename Predicate>
+std::size_t CommandStream::Process(const char *data, std::size_t size, Execute::Response &output,
+                                   Executor &&execute, Predicate &&more) {
+    std::size_t consumed = 0;
+    for (;;) {
+        // There is no command yet
+        if (!_command) {
+            if (consumed == size || !more()) {
+                break;
+            }
+
+            std::size_t parsed = 0;
+            if (_parser.Parse(data + consumed, size - consumed, parsed)) {
+                Build(output);
+            }
+
+            // Parser might fail to consume any bytes from input stream
+            if (parsed == 0) {
+                break;
+            }
+            consumed += parsed;
+        }
+
+        // There is command, but we still wait for argument to arrive...
+        if (_command && _arg_remains > 0) {
+            std::size_t to_read = std::min(_arg_remains, size - consumed);
+            if (!_skip) {
+                _argument.append(data + consumed, to_read);
+            }
+            consumed += to_read;
+            _arg_remains -= to_read;
+            if (_arg_remains > 0) {
+                break;
+            }
+        }
+
+        // There is command & argument - RUN!
+        if (_command) {
+            if (_skip) {
+                output.Append("SERVER_ERROR object too large for cache\r\n");
+            } else if (Complete(output)) {
+                execute(_command, _argument, output);
+            }
+
+            // Prepare for the next command
+            _command.Reset();
+            _argument.resize(0);
+            _parser.Reset();
+            _skip = false;
+        }
+    }
+    return consumed;
+}
+
+// See above
+template <typename Reader> ssize_t CommandStream::ReadArgument(Reader &&read) {
+    if (_skip) {
+        char discard[4096];
+        ssize_t bytes = read(discard, std::min(_arg_remains, sizeof(discard)));
+        if (bytes > 0) {
+            _arg_remains -= bytes;
+        }
+        return bytes;
+    }
+
+    // String grows geometrically once reserved memory is used up
+    std::size_t filled = _argument.size();
+    std::size_t room = std::min(_arg_remains, READ_LIMIT);
+    _argument.resize(filled + room);
+    ssize_t bytes = read(&_argument[filled], room);
+    if (bytes > 0) {
+        _arg_remains -= bytes;
+        filled += bytes;
+    }
+    _argument.resize(filled);
+    return bytes;
+}
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_COMMAND_STREAM_H
@@ -0,0 +1,249 @@
+#include "Handoff.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+namespace Afina {
+namespace Network {
+
+// Byte new instance sends once it serves sockets it has got
+static const char COMMIT = 'y';
+
+// See Handoff.h
+Handoff::Handoff(std::string path, std::shared_ptr<spdlog::logger> logger)
+    : _path(std::move(path)), _logger(std::move(logger)), _peer(-1), _socket(-1), _event_fd(-1),
+      _handed_off(false) {
+    if (_path.empty() || _path.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::runtime_error("Bad handoff socket path: " + _path);
+    }
+}
+
+// See Handoff.h
+Handoff::~Handoff() {
+    Stop();
+    if (_peer >= 0) {
+        close(_peer);
+    }
+}
+
+// See Handoff.h
+std::vector<int> Handoff::Receive() {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, _path.c_str());
+
+    int peer = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (peer == -1) {
+        throw std::runtime_error("Failed to open handoff socket: " + std::string(strerror(errno)));
+    }
+
+    // Stale socket file is left by instance which has crashed
+    if (connect(peer, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        int err = errno;
+        close(peer);
+        if (err == ENOENT || err == ECONNREFUSED) {
+            _logger->warn("No running instance to take listening sockets from");
+            return {};
+        }
+        throw std::runtime_error("Failed to connect to running instance: " + std::string(strerror(err)));
+    }
+
+    uint32_t count = 0;
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = sizeof(count);
+
+    char control[CMSG_SPACE(sizeof(int) * MAX_SOCKETS)];
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    do {
+        received = recvmsg(peer, &msg, MSG_CMSG_CLOEXEC);
+    } while (received == -1 && errno == EINTR);
+
+    std::vector<int> sockets;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            std::size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int *fds = reinterpret_cast<const int *>(CMSG_DATA(cmsg));
+            sockets.insert(sockets.end(), fds, fds + n);
+        }
+    }
+
+    if (received != sizeof(count) || (msg.msg_flags & MSG_CTRUNC) || sockets.size() != count) {
+        for (int fd : sockets) {
+            close(fd);
+        }
+        close(peer);
+        throw std::runtime_error("Failed to receive listening sockets from running instance");
+    }
+
+    _logger->warn("Got {} listening sockets from running instance", sockets.size());
+    _peer = peer;
+    return sockets;
+}
+
+// See Handoff.h
+void Handoff::Commit() {
+    if (_peer < 0) {
+        return;
+    }
+
+    // Previous instance could be gone meanwhile, that is fine as sockets are here already
+    if (send(_peer, &COMMIT, 1, MSG_NOSIGNAL) != 1) {
+        _logger->warn("Failed to confirm handoff: {}", strerror(errno));
+    }
+    close(_peer);
+    _peer = -1;
+}
+
+// See Handoff.h
+void Handoff::Serve(std::vector<int> sockets, std::function<void()> done) {
+    if (sockets.empty() || sockets.size() > MAX_SOCKETS) {
+        throw std::runtime_error("Network service listening sockets can't be handed off");
+    }
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, _path.c_str());
+
+    _socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_socket == -1) {
+        throw std::runtime_error("Failed to open handoff socket: " + std::string(strerror(errno)));
+    }
+
+    // Previous instance doesn't need its path anymore, it is done with handoff
+    unlink(_path.c_str());
+    if (bind(_socket, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(_socket, 1) == -1) {
+        close(_socket);
+        _socket = -1;
+        throw std::runtime_error("Failed to listen on handoff socket: " + std::string(strerror(errno)));
+    }
+
+    _event_fd = eventfd(0, EFD_CLOEXEC);
+    if (_event_fd == -1) {
+        close(_socket);
+        _socket = -1;
+        throw std::runtime_error("Failed to create eventfd: " + std::string(strerror(errno)));
+    }
+
+    _sockets = std::move(sockets);
+    _done = std::move(done);
+    _thread = std::thread(&Handoff::OnRun, this);
+}
+
+// See Handoff.h
+void Handoff::Stop() {
+    if (_thread.joinable()) {
+        eventfd_write(_event_fd, 1);
+        _thread.join();
+    }
+
+    if (_socket >= 0) {
+        close(_socket);
+        close(_event_fd);
+        if (!_handed_off) {
+            unlink(_path.c_str());
+        }
+        _socket = -1;
+        _event_fd = -1;
+    }
+}
+
+// See Handoff.h
+void Handoff::OnRun() {
+    while (Wait(_socket)) {
+        int peer = accept4(_socket, nullptr, nullptr, SOCK_CLOEXEC);
+        if (peer == -1) {
+            _logger->error("Failed to accept handoff connection: {}", strerror(errno));
+            continue;
+        }
+
+        _logger->warn("New instance asks for listening sockets");
+        bool sent = Send(peer);
+        close(peer);
+        if (sent) {
+            _logger->warn("Listening sockets are handed off, stop serving");
+            _handed_off = true;
+            _done();
+            return;
+        }
+        _logger->warn("New instance hasn't taken listening sockets, keep serving");
+    }
+}
+
+// See Handoff.h
+bool Handoff::Send(int peer) {
+    uint32_t count = _sockets.size();
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = sizeof(count);
+
+    char control[CMSG_SPACE(sizeof(int) * MAX_SOCKETS)];
+    std::memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    std::memcpy(CMSG_DATA(cmsg), _sockets.data(), sizeof(int) * count);
+
+    if (sendmsg(peer, &msg, MSG_NOSIGNAL) != sizeof(count)) {
+        _logger->error("Failed to send listening sockets: {}", strerror(errno));
+        return false;
+    }
+
+    // Until confirmation both instances accept on the same sockets, which is fine
+    char reply = 0;
+    ssize_t n = -1;
+    while (Wait(peer) && (n = read(peer, &reply, 1)) == -1 && errno == EINTR) {
+    }
+    return n == 1 && reply == COMMIT;
+}
+
+// See Handoff.h
+bool Handoff::Wait(int fd) {
+    struct pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = _event_fd;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        fds[0].revents = fds[1].revents = 0;
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _logger->error("Failed to wait for handoff: {}", strerror(errno));
+            return false;
+        }
+        return fds[1].revents == 0;
+    }
+}
+
+} // namespace Network
+} // namespace Afina
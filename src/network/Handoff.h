@@ -0,0 +1,96 @@
+#ifndef AFINA_NETWORK_HANDOFF_H
+#define AFINA_NETWORK_HANDOFF_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Network {
+
+/**
+ * # Listening sockets handoff between server instances
+ * Running instance waits for its successor on the unix socket at the given path. New instance connects there,
+ * gets listening sockets through SCM_RIGHTS and starts accepting on them, so port never stops accepting and
+ * no client gets refused during restart.
+ *
+ * Once new instance is up it confirms handoff and the old one stops: it doesn't accept anymore, finishes
+ * commands its clients have already sent and exits. Connections waiting in listen queues are left to the new
+ * instance. If new instance fails to start, connection breaks without confirmation and the old one goes on
+ * serving as if nothing happened
+ */
+class Handoff {
+public:
+    Handoff(std::string path, std::shared_ptr<spdlog::logger> logger);
+    ~Handoff();
+
+    /**
+     * Takes listening sockets from the running instance, returns empty vector if there is nobody to take them
+     * from. Sockets are owned by caller from now on
+     */
+    std::vector<int> Receive();
+
+    /**
+     * Lets previous instance know that its sockets are served by this one now, so it could stop
+     */
+    void Commit();
+
+    /**
+     * Starts background thread waiting for the next instance. Once it has taken sockets over, done is called
+     * from that thread
+     */
+    void Serve(std::vector<int> sockets, std::function<void()> done);
+
+    /**
+     * Stops waiting for the next instance
+     */
+    void Stop();
+
+private:
+    Handoff(const Handoff &) = delete;
+    Handoff &operator=(const Handoff &) = delete;
+
+    // Max number of sockets passed at once, see SCM_MAX_FD
+    static const std::size_t MAX_SOCKETS = 253;
+
+    void OnRun();
+
+    /**
+     * Sends sockets to the next instance and waits until it confirms they are taken over
+     */
+    bool Send(int peer);
+
+    /**
+     * Blocks until descriptor is readable, returns false once handoff is stopped
+     */
+    bool Wait(int fd);
+
+    std::string _path;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Connection to the previous instance, kept until handoff is committed
+    int _peer;
+
+    // Socket next instance connects to and descriptor used to wakeup thread waiting on it
+    int _socket;
+    int _event_fd;
+
+    // Sockets to pass on
+    std::vector<int> _sockets;
+    std::function<void()> _done;
+    std::thread _thread;
+
+    // Path belongs to the next instance once handoff is done
+    bool _handed_off;
+};
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_HANDOFF_H
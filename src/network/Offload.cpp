@@ -0,0 +1,76 @@
+#include "Offload.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <afina/Storage.h>
+#include <afina/concurrency/Executor.h>
+#include <afina/network/Config.h>
+
+namespace Afina {
+namespace Network {
+
+// Jobs waiting for a free thread, once there are more IO thread executes commands by itself
+static const int MAX_QUEUE_SIZE = 1024;
+
+// Idle threads above the first one stop after that many milliseconds
+static const int IDLE_TIME = 5000;
+
+// See Offload.h
+Offload::Offload(std::shared_ptr<Afina::Storage> ps, const Config &config)
+    : _pStorage(std::move(ps)), _max_keys(config.offload_keys), _max_bytes(config.offload_bytes) {
+    _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_event_fd == -1) {
+        throw std::runtime_error("Failed to create event file descriptor: " + std::string(strerror(errno)));
+    }
+
+    _executor.reset(new Concurrency::Executor(1, config.offload_threads, MAX_QUEUE_SIZE, IDLE_TIME));
+    _executor->Start();
+}
+
+// See Offload.h
+Offload::~Offload() {
+    // Jobs still running refer to this instance, so wait for them first
+    _executor->Stop(true);
+    for (Job *job : _done) {
+        delete job;
+    }
+    close(_event_fd);
+}
+
+// See Offload.h
+bool Offload::Submit(Job *job) { return _executor->Execute(&Offload::Run, this, job); }
+
+// See Offload.h
+void Offload::Done(std::vector<Job *> &jobs) {
+    // Event is reset before the list is taken, so job finished in between wakes IO thread up once again
+    eventfd_t value;
+    eventfd_read(_event_fd, &value);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    jobs.swap(_done);
+}
+
+// See Offload.h
+void Offload::Run(Job *job) {
+    job->command.Execute(*_pStorage, std::move(job->args), job->out);
+
+    bool wakeup = false;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        wakeup = _done.empty();
+        _done.push_back(job);
+    }
+
+    // IO thread takes the whole list at once, so it is enough to wake it up for the first job only
+    if (wakeup) {
+        eventfd_write(_event_fd, 1);
+    }
+}
+
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,100 @@
+#ifndef AFINA_NETWORK_OFFLOAD_H
+#define AFINA_NETWORK_OFFLOAD_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Concurrency {
+class Executor;
+}
+
+namespace Network {
+
+// Forward declaration, see afina/network/Config.h
+class Config;
+
+/**
+ * # Heavy commands executor
+ * Multi-get of many keys or command with a large data block takes long enough to stall every other connection
+ * served by the same IO thread. Such commands are executed by thread pool instead, while small ones still run
+ * inline.
+ *
+ * IO thread hands a job over and stops executing commands of that connection until the job is done, so
+ * responses are sent and commands take effect in request order. Finished jobs are collected in a list and IO
+ * thread is woken up through eventfd, which it is expected to have in its epoll.
+ *
+ * Job is owned by pool from Submit until it is taken by Done. Owner field is touched by IO thread only: once
+ * connection is gone before its job is done, owner is reset and job is just dropped on completion
+ */
+class Offload {
+public:
+    struct Job {
+        Execute::Command command;
+        std::string args;
+        Execute::Response out;
+
+        // Connection waiting for the result, nullptr once it is gone
+        void *owner;
+    };
+
+    Offload(std::shared_ptr<Afina::Storage> ps, const Config &config);
+    ~Offload();
+
+    /**
+     * Returns true if command with the given data block size must be executed by pool
+     */
+    bool Heavy(const Execute::Command &command, std::size_t args_size) const {
+        return command.nkeys() >= _max_keys || args_size >= _max_bytes;
+    }
+
+    /**
+     * Queue job for execution. Returns false if pool has no room for it, in which case caller keeps the job
+     * and is expected to execute it inline
+     */
+    bool Submit(Job *job);
+
+    /**
+     * Takes jobs finished since the last call, in order of completion, and resets wakeup event
+     */
+    void Done(std::vector<Job *> &jobs);
+
+    // Descriptor IO thread gets woken up through
+    int EventFd() const { return _event_fd; }
+
+private:
+    Offload(const Offload &) = delete;
+    Offload &operator=(const Offload &) = delete;
+
+    // Pool task
+    void Run(Job *job);
+
+    std::shared_ptr<Afina::Storage> _pStorage;
+
+    // Thresholds of heavy commands, see Config.h
+    std::size_t _max_keys;
+    std::size_t _max_bytes;
+
+    int _event_fd;
+
+    // Finished jobs not taken by IO thread yet
+    std::mutex _mutex;
+    std::vector<Job *> _done;
+
+    std::unique_ptr<Concurrency::Executor> _executor;
+};
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_OFFLOAD_H
@@ -0,0 +1,125 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace Afina {
+namespace Network {
+
+// See TimerWheel.h
+const std::size_t TimerWheel::NO_SLOT;
+
+// See TimerWheel.h
+TimerWheel::TimerWheel(std::size_t timeout) : _tick(1), _timeout_ticks(0), _size(0) {
+    if (timeout > 0) {
+        _tick = (timeout + TICKS_PER_TIMEOUT - 1) / TICKS_PER_TIMEOUT;
+        _timeout_ticks = (timeout + _tick - 1) / _tick;
+    }
+    std::fill(_slots, _slots + SLOTS, nullptr);
+
+    Update();
+    _current = _now;
+}
+
+// See TimerWheel.h
+void TimerWheel::Update(uint64_t now) { _now = now / _tick; }
+
+// See TimerWheel.h
+void TimerWheel::Add(Entry *entry) {
+    if (Enabled()) {
+        entry->last_active.store(_now, std::memory_order_relaxed);
+        Link(entry, Deadline(entry));
+    }
+}
+
+// See TimerWheel.h
+void TimerWheel::Remove(Entry *entry) {
+    if (entry->slot != NO_SLOT) {
+        Unlink(entry);
+    }
+}
+
+// See TimerWheel.h
+void TimerWheel::Expire(std::vector<Entry *> &expired) {
+    // Whole revolution visits every slot, no need to go over it once again
+    uint64_t last = std::min(_now, _current + SLOTS);
+    while (_size > 0 && _current < last) {
+        _current++;
+
+        Entry *entry = _slots[_current % SLOTS];
+        _slots[_current % SLOTS] = nullptr;
+        while (entry != nullptr) {
+            Entry *next = entry->next;
+            entry->slot = NO_SLOT;
+            _size--;
+
+            uint64_t deadline = Deadline(entry);
+            if (deadline <= _now) {
+                expired.push_back(entry);
+            } else {
+                Link(entry, deadline);
+            }
+            entry = next;
+        }
+    }
+    _current = _now;
+}
+
+// See TimerWheel.h
+int TimerWheel::Timeout(uint64_t now) const {
+    if (_size == 0) {
+        return -1;
+    }
+
+    uint64_t tick = _current + 1;
+    while (_slots[tick % SLOTS] == nullptr) {
+        tick++;
+    }
+
+    int64_t left = int64_t(tick * _tick) - int64_t(now);
+    return left > 0 ? int(left) : 0;
+}
+
+// See TimerWheel.h
+uint64_t TimerWheel::Now() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+// See TimerWheel.h
+uint64_t TimerWheel::Deadline(const Entry *entry) const {
+    // Activity could happen at any moment of the tick, so timeout starts with the next one
+    return entry->last_active.load(std::memory_order_relaxed) + _timeout_ticks + 1;
+}
+
+// See TimerWheel.h
+void TimerWheel::Link(Entry *entry, uint64_t tick) {
+    std::size_t slot = tick % SLOTS;
+    entry->slot = slot;
+    entry->prev = nullptr;
+    entry->next = _slots[slot];
+    if (_slots[slot] != nullptr) {
+        _slots[slot]->prev = entry;
+    }
+    _slots[slot] = entry;
+    _size++;
+}
+
+// See TimerWheel.h
+void TimerWheel::Unlink(Entry *entry) {
+    if (entry->prev != nullptr) {
+        entry->prev->next = entry->next;
+    } else {
+        _slots[entry->slot] = entry->next;
+    }
+    if (entry->next != nullptr) {
+        entry->next->prev = entry->prev;
+    }
+
+    entry->prev = entry->next = nullptr;
+    entry->slot = NO_SLOT;
+    _size--;
+}
+
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,138 @@
+#ifndef AFINA_NETWORK_TIMER_WHEEL_H
+#define AFINA_NETWORK_TIMER_WHEEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * # Hashed timing wheel of idle connections
+ * Time is split into ticks, timeout is a fixed number of them. Each connection is linked into the slot of
+ * the tick it is going to expire at, all possible deadlines fit into a single revolution of the wheel.
+ *
+ * Activity on connection just updates its timestamp, so there is no list manipulation per event. Once wheel
+ * reaches the slot, connections which have been active meanwhile are moved to the slot of their actual
+ * deadline, the rest are expired. So each connection is moved at most once per timeout.
+ *
+ * Connection embeds an Entry which points back to it, wheel works with entries only. Wheel is not thread safe,
+ * except for Touch with explicit time: activity could be recorded by any thread while the one owning wheel
+ * moves it
+ */
+class TimerWheel {
+public:
+    // Slot index of connection which isn't in the wheel
+    static const std::size_t NO_SLOT = ~std::size_t(0);
+
+    /**
+     * Position of connection in the wheel
+     */
+    struct Entry {
+        explicit Entry(void *owner)
+            : owner(owner), prev(nullptr), next(nullptr), slot(NO_SLOT), last_active(0) {}
+
+        // Connection entry belongs to
+        void *owner;
+
+        Entry *prev;
+        Entry *next;
+        std::size_t slot;
+        std::atomic<uint64_t> last_active;
+    };
+
+    /**
+     * Timeout is in milliseconds, 0 disables the wheel: nothing is ever expired
+     */
+    explicit TimerWheel(std::size_t timeout);
+
+    inline bool Enabled() const { return _timeout_ticks > 0; }
+
+    /**
+     * Read the clock, connections added or touched after that are considered active at this moment
+     */
+    void Update() { Update(Now()); }
+
+    /**
+     * Same as above, but time in milliseconds is given by caller
+     */
+    void Update(uint64_t now);
+
+    /**
+     * Start tracking connection, it is considered to be active now
+     */
+    void Add(Entry *entry);
+
+    /**
+     * Stop tracking connection, does nothing if it isn't tracked
+     */
+    void Remove(Entry *entry);
+
+    /**
+     * Record activity on connection
+     */
+    void Touch(Entry *entry) { entry->last_active.store(_now, std::memory_order_relaxed); }
+
+    /**
+     * Same as above, but time in milliseconds is given by caller. Doesn't change wheel itself, so could be
+     * called concurrently with other methods
+     */
+    void Touch(Entry *entry, uint64_t now) const { entry->last_active.store(now / _tick, std::memory_order_relaxed); }
+
+    /**
+     * Move wheel up to the last Update and collect connections idle for too long. Expired connections are
+     * not tracked anymore
+     */
+    void Expire(std::vector<Entry *> &expired);
+
+    /**
+     * Returns time in milliseconds until the next slot that must be checked, -1 if there is nothing to wait for.
+     * Suitable to be used as epoll_wait timeout
+     */
+    int Timeout() const { return Timeout(Now()); }
+
+    /**
+     * Same as above, but counted from the given time in milliseconds
+     */
+    int Timeout(uint64_t now) const;
+
+    // Number of connections being tracked
+    std::size_t Size() const { return _size; }
+
+    // Monotonic clock in milliseconds
+    static uint64_t Now();
+
+private:
+    // Number of ticks in timeout, defines precision
+    static const uint64_t TICKS_PER_TIMEOUT = 16;
+
+    // Must be greater than TICKS_PER_TIMEOUT + 1 so that deadlines don't wrap around
+    static const std::size_t SLOTS = 32;
+
+    /**
+     * Tick connection expires at unless there is activity on it
+     */
+    uint64_t Deadline(const Entry *entry) const;
+
+    void Link(Entry *entry, uint64_t tick);
+    void Unlink(Entry *entry);
+
+    // Tick length in milliseconds
+    uint64_t _tick;
+    uint64_t _timeout_ticks;
+
+    // Time of the last Update and tick wheel has been moved to, in ticks
+    uint64_t _now;
+    uint64_t _current;
+
+    // Lists of connections expiring at the slot tick
+    Entry *_slots[SLOTS];
+    std::size_t _size;
+};
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_TIMER_WHEEL_H
@@ -0,0 +1,59 @@
+#include "Unix.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Network {
+
+// See Unix.h
+int make_unix_listen_socket(const std::string &path, int flags) {
+    struct sockaddr_un server_addr;
+    std::memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(server_addr.sun_path)) {
+        throw std::runtime_error("Bad unix socket path: " + path);
+    }
+    std::strcpy(server_addr.sun_path, path.c_str());
+
+    int server_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | flags, 0);
+    if (server_socket == -1) {
+        throw std::runtime_error("Failed to open socket: " + std::string(strerror(errno)));
+    }
+
+    // Unix socket file outlives the socket, unlike TCP port. Anything else at that path is not ours to remove
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            close(server_socket);
+            throw std::runtime_error("Path is taken by something other than socket: " + path);
+        }
+        if (unlink(path.c_str()) == -1 && errno != ENOENT) {
+            close(server_socket);
+            throw std::runtime_error("Failed to remove stale socket file: " + std::string(strerror(errno)));
+        }
+    } else if (errno != ENOENT) {
+        close(server_socket);
+        throw std::runtime_error("Failed to check socket path: " + std::string(strerror(errno)));
+    }
+
+    if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
+        close(server_socket);
+        throw std::runtime_error("Socket bind() failed: " + std::string(strerror(errno)));
+    }
+
+    if (listen(server_socket, SOMAXCONN) == -1) {
+        close(server_socket);
+        throw std::runtime_error("Socket listen() failed: " + std::string(strerror(errno)));
+    }
+    return server_socket;
+}
+
+} // namespace Network
+} // namespace Afina
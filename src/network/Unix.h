@@ -0,0 +1,20 @@
+#ifndef AFINA_NETWORK_UNIX_H
+#define AFINA_NETWORK_UNIX_H
+
+#include <string>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * Creates socket listening for stream connections on the given unix domain socket path, flags are added to
+ * socket type (SOCK_NONBLOCK). Stale socket file is removed first, any other file at the path is left alone
+ * and makes setup fail. File is left in place once socket is closed, as socket could be handed off to the
+ * next instance of the server, see Handoff.h
+ */
+int make_unix_listen_socket(const std::string &path, int flags = 0);
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_UNIX_H
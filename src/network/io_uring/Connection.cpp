@@ -0,0 +1,99 @@
+#include "Connection.h"
+
+#include <algorithm>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Network {
+namespace IOUring {
+
+// See Connection.h
+Connection::~Connection() {
+    _output_size->fetch_sub(_accounted, std::memory_order_relaxed);
+    close(_socket);
+}
+
+// See Connection.h
+void Connection::Process(const char *data, std::size_t size) {
+    // Data received after connection got throttled waits behind the rest
+    std::size_t consumed = _input.empty() ? Run(data, size) : 0;
+    _input.append(data + consumed, size - consumed);
+}
+
+// See Connection.h
+void Connection::Resume() {
+    if (_input.empty()) {
+        return;
+    }
+
+    _input.erase(0, Run(_input.data(), _input.size()));
+    if (_input.empty()) {
+        // Idle connection doesn't hold any memory
+        std::string().swap(_input);
+    }
+}
+
+// See Connection.h
+std::size_t Connection::Run(const char *data, std::size_t size) {
+    auto more = [this]() { return !Throttled(); };
+    auto execute = [this](Execute::Command &command, std::string &args, Execute::Response &output) {
+        command.Execute(*_pStorage, args, output);
+    };
+    return _stream.Process(data, size, _output, execute, more);
+}
+
+// See Connection.h
+bool Connection::Throttled() {
+    std::size_t size = _sending.Size() + _output.Size();
+    if (size >= _high_watermark) {
+        _throttled = true;
+    } else if (size < _low_watermark) {
+        _throttled = false;
+    }
+
+    // Connection without pending responses doesn't hold any memory, so it is free to go on
+    return _throttled ||
+           (size > 0 && _output_limit > 0 && _output_size->load(std::memory_order_relaxed) >= _output_limit);
+}
+
+// See Connection.h
+void Connection::Account() {
+    std::size_t size = _sending.Size() + _output.Size();
+    if (size > _accounted) {
+        _output_size->fetch_add(size - _accounted, std::memory_order_relaxed);
+    } else if (size < _accounted) {
+        _output_size->fetch_sub(_accounted - size, std::memory_order_relaxed);
+    }
+    _accounted = size;
+}
+
+// See Connection.h
+std::size_t Connection::PrepareSend() {
+    if (_sending.Empty()) {
+        _sending.Swap(_output);
+    }
+    _send_inflight = true;
+    return _sending.Prepare(_iov, MAX_IOV);
+}
+
+// See Connection.h
+void Connection::OnSent(std::size_t bytes) {
+    _send_inflight = false;
+    _sending.Consume(bytes);
+}
+
+// See Connection.h
+void Connection::Close() {
+    if (!_closing) {
+        _closing = true;
+        shutdown(_socket, SHUT_RDWR);
+    }
+}
+
+} // namespace IOUring
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,157 @@
+#ifndef AFINA_NETWORK_IO_URING_CONNECTION_H
+#define AFINA_NETWORK_IO_URING_CONNECTION_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <sys/uio.h>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+#include <afina/network/Config.h>
+
+#include "network/CommandStream.h"
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Network {
+namespace IOUring {
+
+/**
+ * # Client connection state
+ * Connection doesn't do any IO by itself: worker submits requests for it into the ring and feeds results
+ * back. There is at most one receive (multishot) and one send in flight for connection at any moment.
+ *
+ * Kernel reads response data right from the connection buffers while send is in flight, so they must
+ * stay untouched: responses of commands executed meanwhile are collected in a separate buffer, which
+ * becomes the one being sent once previous send is done
+ *
+ * Connection stops executing commands once its responses hit the high watermark, or there are too many
+ * responses not sent in all connections together. Worker cancels receive of such connection, data which
+ * has arrived meanwhile is kept until client takes responses
+ */
+class Connection {
+public:
+    Connection(int s, std::shared_ptr<Afina::Storage> ps, const Config &config, std::atomic<std::size_t> *output_size)
+        : _socket(s), _pStorage(std::move(ps)), _high_watermark(config.output_high_watermark),
+          _low_watermark(config.output_low_watermark), _output_limit(config.output_limit), _output_size(output_size),
+          _recv_armed(false), _recv_cancelled(false), _send_inflight(false), _eof(false), _closing(false),
+          _queued(false), _throttled(false), _stream(*_pStorage), _accounted(0) {}
+
+    ~Connection();
+
+    /**
+     * Execute commands from the received chunk of data, the rest is kept if connection gets throttled
+     */
+    void Process(const char *data, std::size_t size);
+
+    /**
+     * Execute commands kept while connection was throttled as long as it fits under output limits
+     */
+    void Resume();
+
+    /**
+     * Checks if connection must stop executing commands until responses are sent
+     */
+    bool Throttled();
+
+    /**
+     * Reflect changes in size of the output queue in total size of all connections
+     */
+    void Account();
+
+    /**
+     * Returns true if there is data to send and no send in flight
+     */
+    inline bool WantSend() const { return !_send_inflight && !(_sending.Empty() && _output.Empty()); }
+
+    /**
+     * Fills iov with data to send next, returns number of used entries
+     */
+    std::size_t PrepareSend();
+
+    /**
+     * Marks given number of bytes as sent
+     */
+    void OnSent(std::size_t bytes);
+
+    /**
+     * Connection is done and could be released once kernel has no requests for it
+     */
+    inline bool isAlive() const {
+        return !_closing && !(_eof && _input.empty() && !_send_inflight && _sending.Empty() && _output.Empty());
+    }
+    inline bool CanDelete() const { return !_recv_armed && !_send_inflight; }
+
+    /**
+     * Stop serving connection, requests in flight get completed with error
+     */
+    void Close();
+
+private:
+    friend class Worker;
+
+    // Size of vectors for single send
+    static const std::size_t MAX_IOV = 64;
+
+    /**
+     * Execute commands while connection isn't throttled, returns number of bytes consumed
+     */
+    std::size_t Run(const char *data, std::size_t size);
+
+    int _socket;
+    std::shared_ptr<Afina::Storage> _pStorage;
+
+    // Output limits, see Config.h
+    std::size_t _high_watermark;
+    std::size_t _low_watermark;
+    std::size_t _output_limit;
+
+    // Total size of responses in all connections of the server
+    std::atomic<std::size_t> *_output_size;
+
+    // Multishot receive is submitted and has not been terminated yet
+    bool _recv_armed;
+
+    // Cancellation of receive is submitted
+    bool _recv_cancelled;
+
+    // Send request is submitted, _sending and _iov are used by kernel
+    bool _send_inflight;
+
+    // Client has closed its side
+    bool _eof;
+
+    // Connection is going to be released
+    bool _closing;
+
+    // Connection is in worker list of connections having data to send
+    bool _queued;
+
+    // Output queue has hit high watermark and hasn't gone below low one yet
+    bool _throttled;
+
+    // Received bytes not processed yet because connection is throttled
+    std::string _input;
+
+    // Parse state of the stream
+    CommandStream _stream;
+
+    // Responses being sent and collected meanwhile
+    Execute::Response _sending;
+    Execute::Response _output;
+    struct iovec _iov[MAX_IOV];
+
+    // Part of _output_size contributed by this connection
+    std::size_t _accounted;
+};
+
+} // namespace IOUring
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_IO_URING_CONNECTION_H
@@ -0,0 +1,310 @@
+#include "Ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Network {
+namespace IOUring {
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// See Ring.h
+Ring::Ring()
+    : _fd(-1), _sq_ptr(MAP_FAILED), _sq_size(0), _sq_head(nullptr), _sq_tail(nullptr), _sq_array(nullptr), _sq_mask(0),
+      _sq_entries(0), _sqes(static_cast<struct io_uring_sqe *>(MAP_FAILED)), _sqes_size(0), _sqe_tail(0),
+      _cq_ptr(MAP_FAILED), _cq_size(0), _cq_head(nullptr), _cq_tail(nullptr), _cq_mask(0), _cqes(nullptr),
+      _buf_ring(static_cast<struct io_uring_buf_ring *>(MAP_FAILED)), _buf_ring_size(0), _buf_memory(nullptr),
+      _buf_group(0), _buf_count(0), _buf_size(0), _buf_tail(0) {}
+
+// See Ring.h
+Ring::~Ring() {
+    // Closing ring cancels everything still in flight, so buffers could be released after that
+    if (_fd >= 0) {
+        close(_fd);
+    }
+    if (_buf_ring != MAP_FAILED) {
+        munmap(_buf_ring, _buf_ring_size);
+    }
+    delete[] _buf_memory;
+    if (_sqes != MAP_FAILED) {
+        munmap(_sqes, _sqes_size);
+    }
+    if (_sq_ptr != MAP_FAILED) {
+        munmap(_sq_ptr, _sq_size);
+    }
+}
+
+// See Ring.h
+std::string Ring::Probe() {
+    Ring ring;
+    try {
+        ring.Init(8);
+    } catch (std::runtime_error &ex) {
+        return ex.what();
+    }
+
+    const unsigned max_ops = 256;
+    std::vector<char> buffer(sizeof(struct io_uring_probe) + max_ops * sizeof(struct io_uring_probe_op), 0);
+    struct io_uring_probe *probe = reinterpret_cast<struct io_uring_probe *>(buffer.data());
+    if (io_uring_register(ring._fd, IORING_REGISTER_PROBE, probe, max_ops) < 0) {
+        return "Failed to probe io_uring operations: " + std::string(strerror(errno));
+    }
+
+    // Multishot receive has no own probe, it was introduced in the same release as zero copy send
+    const struct {
+        unsigned op;
+        const char *name;
+    } required[] = {{IORING_OP_ACCEPT, "accept"},
+                    {IORING_OP_RECV, "recv"},
+                    {IORING_OP_WRITEV, "writev"},
+                    {IORING_OP_POLL_ADD, "poll_add"},
+                    {IORING_OP_ASYNC_CANCEL, "async_cancel"},
+                    {IORING_OP_PROVIDE_BUFFERS, "provide_buffers"},
+                    {IORING_OP_SEND_ZC, "multishot recv"}};
+    for (auto &r : required) {
+        if (r.op > probe->last_op || !(probe->ops[r.op].flags & IO_URING_OP_SUPPORTED)) {
+            return "io_uring doesn't support " + std::string(r.name);
+        }
+    }
+    return "";
+}
+
+// See Ring.h
+void Ring::Init(unsigned entries) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    // Each multishot request could produce lots of completions, so give them more room
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    _fd = io_uring_setup(entries, &params);
+    if (_fd < 0) {
+        throw std::runtime_error("Failed to setup io_uring: " + std::string(strerror(errno)));
+    }
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        throw std::runtime_error("io_uring doesn't support single mmap");
+    }
+
+    _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    _sq_size = std::max(_sq_size, _cq_size);
+    _sq_ptr = mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    if (_sq_ptr == MAP_FAILED) {
+        throw std::runtime_error("Failed to map io_uring queues: " + std::string(strerror(errno)));
+    }
+    _cq_ptr = _sq_ptr;
+
+    _sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    _sqes = static_cast<struct io_uring_sqe *>(
+        mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES));
+    if (_sqes == MAP_FAILED) {
+        throw std::runtime_error("Failed to map io_uring entries: " + std::string(strerror(errno)));
+    }
+
+    char *sq = static_cast<char *>(_sq_ptr);
+    _sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    _sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    _sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    _sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    _sq_entries = params.sq_entries;
+    _sqe_tail = *_sq_tail;
+
+    char *cq = static_cast<char *>(_cq_ptr);
+    _cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    _cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    _cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+}
+
+// See Ring.h
+void Ring::SetupBuffers(uint16_t group, unsigned count, unsigned size) {
+    _buf_group = group;
+    _buf_count = count;
+    _buf_size = size;
+    _buf_memory = new char[size_t(count) * size];
+    if (SetupBufferRing()) {
+        return;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        ProvideBuffer(i);
+    }
+}
+
+// See Ring.h
+bool Ring::SetupBufferRing() {
+    _buf_ring_size = _buf_count * sizeof(struct io_uring_buf);
+    void *ptr = mmap(nullptr, _buf_ring_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw std::runtime_error("Failed to allocate buffers ring: " + std::string(strerror(errno)));
+    }
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ptr);
+    reg.ring_entries = _buf_count;
+    reg.bgid = _buf_group;
+    if (io_uring_register(_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ptr, _buf_ring_size);
+        return false;
+    }
+
+    _buf_ring = static_cast<struct io_uring_buf_ring *>(ptr);
+    _buf_tail = 0;
+    for (unsigned i = 0; i < _buf_count; i++) {
+        ReleaseBuffer(i);
+    }
+    __atomic_store_n(&_buf_ring->tail, _buf_tail, __ATOMIC_RELEASE);
+
+    // Some kernels accept registration but never select buffers out of the ring, check it on a real receive
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+        throw std::runtime_error("Failed to create socket pair: " + std::string(strerror(errno)));
+    }
+
+    bool works = false;
+    if (write(sv[1], "", 1) == 1) {
+        struct io_uring_sqe *sqe = GetSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = sv[0];
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = _buf_group;
+        sqe->user_data = INTERNAL_USER_DATA;
+        Submit(1);
+
+        struct io_uring_cqe *cqe = &_cqes[*_cq_head & _cq_mask];
+        if (*_cq_head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+            works = (cqe->res == 1) && (cqe->flags & IORING_CQE_F_BUFFER);
+            if (works) {
+                ReleaseBuffer(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+            SeenCqe();
+        }
+    }
+    close(sv[0]);
+    close(sv[1]);
+    if (works) {
+        return true;
+    }
+
+    reg.ring_addr = 0;
+    io_uring_register(_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    munmap(_buf_ring, _buf_ring_size);
+    _buf_ring = static_cast<struct io_uring_buf_ring *>(MAP_FAILED);
+    return false;
+}
+
+// See Ring.h
+void Ring::ReleaseBuffer(uint16_t bid) {
+    if (_buf_ring == MAP_FAILED) {
+        ProvideBuffer(bid);
+        return;
+    }
+
+    struct io_uring_buf *buf = &_buf_ring->bufs[_buf_tail & (_buf_count - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(Buffer(bid));
+    buf->len = _buf_size;
+    buf->bid = bid;
+    _buf_tail++;
+}
+
+// See Ring.h
+void Ring::ProvideBuffer(uint16_t bid) {
+    struct io_uring_sqe *sqe = GetSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->fd = 1;
+    sqe->addr = reinterpret_cast<uint64_t>(Buffer(bid));
+    sqe->len = _buf_size;
+    sqe->off = bid;
+    sqe->buf_group = _buf_group;
+    sqe->user_data = INTERNAL_USER_DATA;
+}
+
+// See Ring.h
+struct io_uring_sqe *Ring::GetSqe() {
+    if (_sqe_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries) {
+        Submit(0);
+        if (_sqe_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries) {
+            throw std::runtime_error("io_uring submission queue overflow");
+        }
+    }
+
+    unsigned index = _sqe_tail & _sq_mask;
+    struct io_uring_sqe *sqe = &_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    _sq_array[index] = index;
+    _sqe_tail++;
+    return sqe;
+}
+
+// See Ring.h
+void Ring::Submit(unsigned wait_nr) {
+    if (_buf_ring != MAP_FAILED) {
+        __atomic_store_n(&_buf_ring->tail, _buf_tail, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(_sq_tail, _sqe_tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = _sqe_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+    if (to_submit == 0 && wait_nr == 0) {
+        return;
+    }
+
+    while (io_uring_enter(_fd, to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0) < 0) {
+        if (errno == EINTR) {
+            continue;
+        }
+
+        // Completion queue is full, caller must reap it first. Unsubmitted entries will go with the next call
+        if (errno == EBUSY || errno == EAGAIN) {
+            return;
+        }
+        throw std::runtime_error("io_uring_enter failed: " + std::string(strerror(errno)));
+    }
+}
+
+// See Ring.h
+struct io_uring_cqe *Ring::PeekCqe() {
+    for (;;) {
+        unsigned head = *_cq_head;
+        if (head == __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+            return nullptr;
+        }
+
+        struct io_uring_cqe *cqe = &_cqes[head & _cq_mask];
+        if (cqe->user_data != INTERNAL_USER_DATA) {
+            return cqe;
+        }
+
+        // Buffer which kernel failed to take is lost, receives just get less of them
+        SeenCqe();
+    }
+}
+
+// See Ring.h
+void Ring::SeenCqe() { __atomic_store_n(_cq_head, *_cq_head + 1, __ATOMIC_RELEASE); }
+
+} // namespace IOUring
+} // namespace Network
+} // namespace Afina
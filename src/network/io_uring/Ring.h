@@ -0,0 +1,130 @@
+#ifndef AFINA_NETWORK_IO_URING_RING_H
+#define AFINA_NETWORK_IO_URING_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <linux/io_uring.h>
+
+namespace Afina {
+namespace Network {
+namespace IOUring {
+
+/**
+ * # Thin wrapper around io_uring instance
+ * Maps submission/completion queues of the ring into process memory and provides access to them
+ * using raw system calls, so there is no dependency on liburing.
+ *
+ * Ring could have a single group of provided buffers: kernel picks one of them once data arrives,
+ * so receives don't pin memory of idle connections. Buffers are given to kernel through shared buffer
+ * ring; if kernel can't use it, then they are handed over by IORING_OP_PROVIDE_BUFFERS requests, which
+ * go together with other submissions.
+ *
+ * Instance is not thread safe and must be used by a single thread
+ */
+class Ring {
+public:
+    Ring();
+    ~Ring();
+
+    /**
+     * Checks that running kernel supports all features server relies on. Returns empty string if so,
+     * otherwise description of the missing feature
+     */
+    static std::string Probe();
+
+    /**
+     * Creates ring with the given number of submission entries, throws std::runtime_error on failure
+     */
+    void Init(unsigned entries);
+
+    /**
+     * Registers group of count buffers each size bytes long, count must be power of 2
+     */
+    void SetupBuffers(uint16_t group, unsigned count, unsigned size);
+
+    /**
+     * Returns next free submission entry, cleared. If submission queue is full, pending entries
+     * are submitted first
+     */
+    struct io_uring_sqe *GetSqe();
+
+    /**
+     * Submits all pending entries and waits until at least wait_nr completions are available
+     */
+    void Submit(unsigned wait_nr);
+
+    /**
+     * Returns next available completion or nullptr. Completion must be released with SeenCqe once
+     * processed
+     */
+    struct io_uring_cqe *PeekCqe();
+    void SeenCqe();
+
+    /**
+     * Access provided buffer selected by the kernel
+     */
+    inline char *Buffer(uint16_t bid) const { return _buf_memory + size_t(bid) * _buf_size; }
+
+    /**
+     * Gives buffer back to the kernel, takes effect on the next Submit
+     */
+    void ReleaseBuffer(uint16_t bid);
+
+private:
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    // Marks completions of requests issued by the ring itself, they are never returned by PeekCqe
+    static const uint64_t INTERNAL_USER_DATA = ~uint64_t(0);
+
+    /**
+     * Registers buffer ring and checks that kernel is actually able to take buffers from it
+     */
+    bool SetupBufferRing();
+
+    /**
+     * Submit request giving buffer to kernel, used when there is no buffer ring
+     */
+    void ProvideBuffer(uint16_t bid);
+
+    int _fd;
+
+    // Submission queue
+    void *_sq_ptr;
+    size_t _sq_size;
+    unsigned *_sq_head;
+    unsigned *_sq_tail;
+    unsigned *_sq_array;
+    unsigned _sq_mask;
+    unsigned _sq_entries;
+    struct io_uring_sqe *_sqes;
+    size_t _sqes_size;
+
+    // Local copy of submission tail, published to kernel by Submit
+    unsigned _sqe_tail;
+
+    // Completion queue
+    void *_cq_ptr;
+    size_t _cq_size;
+    unsigned *_cq_head;
+    unsigned *_cq_tail;
+    unsigned _cq_mask;
+    struct io_uring_cqe *_cqes;
+
+    // Provided buffers
+    struct io_uring_buf_ring *_buf_ring;
+    size_t _buf_ring_size;
+    char *_buf_memory;
+    uint16_t _buf_group;
+    unsigned _buf_count;
+    unsigned _buf_size;
+    uint16_t _buf_tail;
+};
+
+} // namespace IOUring
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_IO_URING_RING_H
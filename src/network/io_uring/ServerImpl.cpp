@@ -0,0 +1,131 @@
+#include "ServerImpl.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/Storage.h>
+#include <afina/logging/Service.h>
+
+#include "Ring.h"
+#include "Worker.h"
+#include "network/mt_nonblocking/ServerImpl.h"
+#include "network/mt_nonblocking/Utils.h"
+
+namespace Afina {
+namespace Network {
+namespace IOUring {
+
+// See Server.h
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl,
+                       std::shared_ptr<Config> pc)
+    : Server(ps, pl, pc), _event_fd(-1), _output_size(0) {}
+
+// See Server.h
+ServerImpl::~ServerImpl() {}
+
+// See Server.h
+void ServerImpl::Start(uint16_t port, uint32_t n_acceptors, uint32_t n_workers) {
+    _logger = pLogging->select("network");
+
+    std::string missing = Ring::Probe();
+    if (!missing.empty()) {
+        _logger->warn("io_uring can't be used ({}), fallback to mt_nonblocking", missing);
+
+        std::shared_ptr<Config> config = std::make_shared<Config>(*pConfig);
+        config->reuseport = true;
+        pConfig->listen_sockets.clear(); // taken by fallback
+        _fallback.reset(new MTnonblock::ServerImpl(pStorage, pLogging, config));
+        _fallback->Start(port, n_acceptors, n_workers);
+        return;
+    }
+    _logger->info("Start io_uring network service");
+
+    sigset_t sig_mask;
+    sigemptyset(&sig_mask);
+    sigaddset(&sig_mask, SIGPIPE);
+    if (pthread_sigmask(SIG_BLOCK, &sig_mask, NULL) != 0) {
+        throw std::runtime_error("Unable to mask SIGPIPE");
+    }
+
+    // Each client takes a descriptor, so default soft limit of 1024 is far too low for
+    // the number of connections server is expected to handle
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0 && nofile.rlim_cur < nofile.rlim_max) {
+        nofile.rlim_cur = nofile.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &nofile) != 0) {
+            _logger->warn("Failed to raise open files limit: {}", strerror(errno));
+        }
+    }
+
+    _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_event_fd == -1) {
+        throw std::runtime_error("Failed to create event file descriptor: " + std::string(strerror(errno)));
+    }
+
+    _workers.reserve(n_workers);
+    for (uint32_t i = 0; i < n_workers; i++) {
+        // Socket handed over by the previous instance is already bound and listening
+        int fd = pConfig->TakeListenSocket();
+        if (fd >= 0) {
+            _logger->warn("Use inherited listening socket {}", fd);
+        } else {
+            // Ring waits for connections itself, so socket stays blocking
+            fd = MTnonblock::make_listen_socket(port, true, SOCK_CLOEXEC);
+        }
+        _sockets.push_back(fd);
+        _workers.emplace_back(pStorage, pLogging, pConfig, &_output_size);
+        _workers.back().Start(_sockets.back(), _event_fd);
+    }
+}
+
+// See Server.h
+void ServerImpl::Stop() {
+    if (_fallback) {
+        _fallback->Stop();
+        return;
+    }
+
+    _logger->warn("Stop network service");
+    if (eventfd_write(_event_fd, 1)) {
+        throw std::runtime_error("Failed to wakeup workers");
+    }
+}
+
+// See Server.h
+void ServerImpl::Join() {
+    if (_fallback) {
+        _fallback->Join();
+        return;
+    }
+
+    for (auto &w : _workers) {
+        w.Join();
+    }
+    _workers.clear();
+
+    for (int fd : _sockets) {
+        close(fd);
+    }
+    _sockets.clear();
+    close(_event_fd);
+    _event_fd = -1;
+}
+
+// See Server.h
+std::vector<int> ServerImpl::ListenSockets() const {
+    if (_fallback) {
+        return _fallback->ListenSockets();
+    }
+    return _sockets;
+}
+
+} // namespace IOUring
+} // namespace Network
+} // namespace Afina
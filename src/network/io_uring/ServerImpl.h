@@ -0,0 +1,71 @@
+#ifndef AFINA_NETWORK_IO_URING_SERVER_H
+#define AFINA_NETWORK_IO_URING_SERVER_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <afina/network/Server.h>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Network {
+namespace IOUring {
+
+// Forward declaration, see Worker.h
+class Worker;
+
+/**
+ * # Network resource manager implementation
+ * io_uring based server: each worker thread has its own ring and listening socket. Connections are
+ * accepted by multishot accept, data is received by multishot receive into buffers provided by worker
+ * and responses are sent with writev requests, submitted in batches.
+ *
+ * If running kernel lacks any of these features, server falls back to mt_nonblocking one with
+ * per-worker listening sockets
+ */
+class ServerImpl : public Server {
+public:
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl, std::shared_ptr<Config> pc);
+    ~ServerImpl();
+
+    // See Server.h
+    void Start(uint16_t port, uint32_t acceptors, uint32_t workers) override;
+
+    // See Server.h
+    void Stop() override;
+
+    // See Server.h
+    void Join() override;
+
+    // See Server.h
+    std::vector<int> ListenSockets() const override;
+
+private:
+    // logger to use
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Server used instead of this one if io_uring can't be used
+    std::unique_ptr<Server> _fallback;
+
+    // Curstom event "device" used to wakeup workers
+    int _event_fd;
+
+    // Listening sockets, one per worker
+    std::vector<int> _sockets;
+
+    // Total size of responses not sent yet, see Config::output_limit
+    std::atomic<std::size_t> _output_size;
+
+    // threads serving read/write requests
+    std::vector<Worker> _workers;
+};
+
+} // namespace IOUring
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_IO_URING_SERVER_H
@@ -0,0 +1,332 @@
+#include "Worker.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/logging/Service.h>
+#include <afina/network/Config.h>
+
+#include "Connection.h"
+#include "Ring.h"
+
+namespace Afina {
+namespace Network {
+namespace IOUring {
+
+// Number of submission queue entries in each ring
+static const unsigned RING_ENTRIES = 4096;
+
+// Provided buffers used to receive data, shared by all connections of the worker
+static const uint16_t BUFFER_GROUP = 0;
+static const unsigned BUFFER_COUNT = 1024;
+static const unsigned BUFFER_SIZE = 4096;
+
+// See Worker.h
+Worker::Worker(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Afina::Logging::Service> pl,
+               std::shared_ptr<Config> pc, std::atomic<std::size_t> *output_size)
+    : _pStorage(ps), _pLogging(pl), _pConfig(pc), _output_size(output_size), _listen_socket(-1), _event_fd(-1),
+      _stopping(false), _busy_poll(pc->busy_poll) {}
+
+// See Worker.h
+Worker::~Worker() {}
+
+// See Worker.h
+Worker::Worker(Worker &&other) : _output_size(nullptr), _busy_poll(0) { *this = std::move(other); }
+
+// See Worker.h
+Worker &Worker::operator=(Worker &&other) {
+    _pStorage = std::move(other._pStorage);
+    _pLogging = std::move(other._pLogging);
+    _pConfig = std::move(other._pConfig);
+    _output_size = other._output_size;
+    _logger = std::move(other._logger);
+    _thread = std::move(other._thread);
+    _listen_socket = other._listen_socket;
+    _event_fd = other._event_fd;
+    _stopping = other._stopping;
+    _busy_poll = other._busy_poll;
+    _ring = std::move(other._ring);
+    _connections = std::move(other._connections);
+    _send_queue = std::move(other._send_queue);
+
+    other._listen_socket = -1;
+    other._event_fd = -1;
+    return *this;
+}
+
+// See Worker.h
+void Worker::Start(int listen_socket, int event_fd) {
+    assert(!_thread.joinable());
+    _listen_socket = listen_socket;
+    _event_fd = event_fd;
+    _stopping = false;
+    _logger = _pLogging->select("network.worker");
+    _thread = std::thread(&Worker::OnRun, this);
+}
+
+// See Worker.h
+void Worker::Join() {
+    assert(_thread.joinable());
+    _thread.join();
+}
+
+// See Worker.h
+void Worker::OnRun() {
+    _logger->trace("OnRun");
+    try {
+        _ring.reset(new Ring());
+        _ring->Init(RING_ENTRIES);
+        _ring->SetupBuffers(BUFFER_GROUP, BUFFER_COUNT, BUFFER_SIZE);
+
+        ArmAccept();
+        ArmWakeup();
+        std::chrono::steady_clock::time_point spin_until;
+        while (!_stopping || !_connections.empty()) {
+            bool spin = _busy_poll.count() > 0 && std::chrono::steady_clock::now() < spin_until;
+            _ring->Submit(spin ? 0 : 1);
+
+            struct io_uring_cqe *cqe;
+            bool reaped = false;
+            while ((cqe = _ring->PeekCqe()) != nullptr) {
+                reaped = true;
+                uint64_t user_data = cqe->user_data;
+                int res = cqe->res;
+                uint32_t flags = cqe->flags;
+                _ring->SeenCqe();
+
+                Connection *pc = reinterpret_cast<Connection *>(user_data & ~OP_MASK);
+                switch (user_data & OP_MASK) {
+                case kAccept:
+                    OnAccept(res, flags);
+                    break;
+                case kWakeup:
+                    // Stop reading new commands, connections get closed once all responses are sent
+                    _logger->debug("Stop worker, {} connections left", _connections.size());
+                    _stopping = true;
+                    CancelAccept();
+                    for (Connection *conn : _connections) {
+                        shutdown(conn->_socket, SHUT_RD);
+                    }
+                    break;
+                case kCancel:
+                    // Request has already been terminated, nothing to cancel
+                    break;
+                case kRecv:
+                    OnRecv(pc, res, flags);
+                    break;
+                case kSend:
+                    OnSend(pc, res);
+                    break;
+                }
+            }
+
+            // Send responses for all commands executed in this round, submitted together with the next wait
+            std::vector<Connection *> queue;
+            queue.swap(_send_queue);
+            for (Connection *pc : queue) {
+                pc->_queued = false;
+                if (pc->isAlive() && pc->WantSend()) {
+                    ArmSend(pc);
+                } else {
+                    Update(pc);
+                }
+            }
+            queue.clear();
+            _send_queue.swap(queue);
+
+            if (_busy_poll.count() > 0 && reaped) {
+                spin_until = std::chrono::steady_clock::now() + _busy_poll;
+            } else if (spin && !reaped) {
+                // Spinning worker must not starve threads it shares core with
+                std::this_thread::yield();
+            }
+        }
+    } catch (std::runtime_error &ex) {
+        _logger->error("Worker failed: {}", ex.what());
+    }
+
+    // Ring must go first, so that kernel is done with connections buffers
+    _ring.reset();
+    for (Connection *pc : _connections) {
+        delete pc;
+    }
+    _connections.clear();
+    _send_queue.clear();
+    _logger->warn("Worker stopped");
+}
+
+// See Worker.h
+void Worker::ArmAccept() {
+    struct io_uring_sqe *sqe = _ring->GetSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = _listen_socket;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = kAccept;
+}
+
+// See Worker.h
+void Worker::CancelAccept() {
+    // Listening socket stays open, connections waiting in its queue are left for the next instance if any
+    struct io_uring_sqe *sqe = _ring->GetSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->addr = kAccept;
+    sqe->user_data = kCancel;
+}
+
+// See Worker.h
+void Worker::ArmWakeup() {
+    struct io_uring_sqe *sqe = _ring->GetSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = _event_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = kWakeup;
+}
+
+// See Worker.h
+void Worker::ArmRecv(Connection *pc) {
+    struct io_uring_sqe *sqe = _ring->GetSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = pc->_socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = reinterpret_cast<uint64_t>(pc) | kRecv;
+    pc->_recv_armed = true;
+}
+
+// See Worker.h
+void Worker::CancelRecv(Connection *pc) {
+    struct io_uring_sqe *sqe = _ring->GetSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->addr = reinterpret_cast<uint64_t>(pc) | kRecv;
+    sqe->user_data = kCancel;
+    pc->_recv_cancelled = true;
+}
+
+// See Worker.h
+void Worker::ArmSend(Connection *pc) {
+    std::size_t iovcnt = pc->PrepareSend();
+
+    struct io_uring_sqe *sqe = _ring->GetSqe();
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = pc->_socket;
+    sqe->addr = reinterpret_cast<uint64_t>(pc->_iov);
+    sqe->len = iovcnt;
+    sqe->user_data = reinterpret_cast<uint64_t>(pc) | kSend;
+}
+
+// See Worker.h
+void Worker::OnAccept(int res, uint32_t flags) {
+    if (res >= 0) {
+        _logger->debug("Accepted connection on descriptor {}", res);
+        Connection *pc = new Connection(res, _pStorage, *_pConfig, _output_size);
+        _connections.insert(pc);
+        ArmRecv(pc);
+
+        // Client accepted before cancellation took effect is served like the rest of connections being drained
+        if (_stopping) {
+            shutdown(res, SHUT_RD);
+        }
+    } else if (res != -ECANCELED) {
+        _logger->error("Failed to accept socket: {}", strerror(-res));
+    }
+
+    // Multishot accept could be terminated by kernel, request it again
+    if (!(flags & IORING_CQE_F_MORE) && !_stopping) {
+        ArmAccept();
+    }
+}
+
+// See Worker.h
+void Worker::OnRecv(Connection *pc, int res, uint32_t flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        pc->_recv_armed = false;
+        pc->_recv_cancelled = false;
+    }
+
+    if (res > 0) {
+        uint16_t bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        if (pc->isAlive()) {
+            pc->Process(_ring->Buffer(bid), res);
+        }
+        _ring->ReleaseBuffer(bid);
+    } else if (res == 0) {
+        _logger->debug("Connection on descriptor {} closed by client", pc->_socket);
+        pc->_eof = true;
+    } else if (res != -ENOBUFS && res != -ECANCELED) {
+        _logger->debug("Failed to read from descriptor {}: {}", pc->_socket, strerror(-res));
+        pc->Close();
+    }
+
+    // Receive stops once all provided buffers are in use, continue as they are returned back by now
+    Receive(pc);
+    Update(pc);
+}
+
+// See Worker.h
+void Worker::OnSend(Connection *pc, int res) {
+    if (res >= 0) {
+        pc->OnSent(res);
+    } else {
+        pc->OnSent(0);
+        if (res != -EINTR && res != -EAGAIN) {
+            _logger->debug("Failed to write to descriptor {}: {}", pc->_socket, strerror(-res));
+            pc->Close();
+        }
+    }
+
+    // Client takes responses, so commands received meanwhile could go on
+    if (pc->isAlive()) {
+        pc->Resume();
+        Receive(pc);
+    }
+    Update(pc);
+}
+
+// See Worker.h
+void Worker::Receive(Connection *pc) {
+    if (pc->_recv_armed) {
+        if (!pc->_recv_cancelled && pc->Throttled()) {
+            CancelRecv(pc);
+        }
+    } else if (pc->isAlive() && !pc->_eof && !pc->Throttled()) {
+        ArmRecv(pc);
+    }
+}
+
+// See Worker.h
+void Worker::Update(Connection *pc) {
+    pc->Account();
+    if (pc->_queued) {
+        return;
+    }
+
+    if (pc->isAlive()) {
+        if (pc->WantSend()) {
+            pc->_queued = true;
+            _send_queue.push_back(pc);
+        }
+        return;
+    }
+
+    pc->Close();
+    if (pc->CanDelete()) {
+        _connections.erase(pc);
+        delete pc;
+    }
+}
+
+} // namespace IOUring
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,144 @@
+#ifndef AFINA_NETWORK_IO_URING_WORKER_H
+#define AFINA_NETWORK_IO_URING_WORKER_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+namespace Logging {
+class Service;
+}
+
+namespace Network {
+
+// Forward declaration, see afina/network/Config.h
+class Config;
+
+namespace IOUring {
+
+// Forward declarations, see Connection.h and Ring.h
+class Connection;
+class Ring;
+
+/**
+ * # Thread running io_uring
+ * Each worker has its own ring and listening socket, accepts connections and serves them until close.
+ *
+ * All requests prepared during processing of completions are submitted by a single system call, which
+ * also waits for next completions. In busy poll mode worker peeks at completion queue without waiting for
+ * a while after the last completion, see Config::busy_poll
+ *
+ * Receive of connection which has hit output limits is cancelled and armed again once client takes
+ * responses, so kernel doesn't keep filling provided buffers for it
+ */
+class Worker {
+public:
+    Worker(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Afina::Logging::Service> pl,
+           std::shared_ptr<Config> pc, std::atomic<std::size_t> *output_size);
+    ~Worker();
+
+    Worker(Worker &&);
+    Worker &operator=(Worker &&);
+
+    /**
+     * Spaws background thread accepting connections on the given socket. Once event_fd becomes readable
+     * worker stops to read new commands, sends out responses of already executed ones and exits
+     */
+    void Start(int listen_socket, int event_fd);
+
+    /**
+     * Blocks calling thread until background one for this worker is actually
+     * been destoryed
+     */
+    void Join();
+
+protected:
+    /**
+     * Method executing by background thread
+     */
+    void OnRun();
+
+private:
+    Worker(Worker &) = delete;
+    Worker &operator=(Worker &) = delete;
+
+    // Kind of request, stored in lower bits of the request user data
+    enum Op : uint64_t { kAccept = 0, kWakeup = 1, kRecv = 2, kSend = 3, kCancel = 4 };
+    static const uint64_t OP_MASK = 7;
+
+    void ArmAccept();
+    void CancelAccept();
+    void ArmWakeup();
+    void ArmRecv(Connection *pc);
+    void CancelRecv(Connection *pc);
+    void ArmSend(Connection *pc);
+
+    /**
+     * Keep receive armed while connection executes commands, cancel it once connection is throttled
+     */
+    void Receive(Connection *pc);
+
+    void OnAccept(int res, uint32_t flags);
+    void OnRecv(Connection *pc, int res, uint32_t flags);
+    void OnSend(Connection *pc, int res);
+
+    /**
+     * Queue connection for send or release it if it is done
+     */
+    void Update(Connection *pc);
+
+    // afina services
+    std::shared_ptr<Afina::Storage> _pStorage;
+
+    // afina services
+    std::shared_ptr<Afina::Logging::Service> _pLogging;
+
+    // Network settings
+    std::shared_ptr<Config> _pConfig;
+
+    // Total size of responses not sent yet, see Config::output_limit
+    std::atomic<std::size_t> *_output_size;
+
+    // Logger to be used
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Thread serving requests in this worker
+    std::thread _thread;
+
+    // Socket to accept connections on
+    int _listen_socket;
+
+    // Server notifies worker to stop through this descriptor
+    int _event_fd;
+
+    // Worker is going to stop
+    bool _stopping;
+
+    // Time to poll completions without waiting after the last one
+    std::chrono::microseconds _busy_poll;
+
+    std::unique_ptr<Ring> _ring;
+
+    // All connections served by the worker
+    std::unordered_set<Connection *> _connections;
+
+    // Connections got data to send during current round of completions
+    std::vector<Connection *> _send_queue;
+};
+
+} // namespace IOUring
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_IO_URING_WORKER_H
@@ -0,0 +1,92 @@
+#include "Connection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/Storage.h>
+
+#include "network/Blocking.h"
+
+namespace Afina {
+namespace Network {
+namespace MTblocking {
+
+// See Connection.h
+Connection::~Connection() {
+    close(_socket);
+    _logger->debug("Connection {} closed", _socket);
+}
+
+// See Connection.h
+bool Connection::Serve(bool nonblock) {
+    // Responses are sent once the whole read is processed, large ones are pushed out meanwhile
+    auto execute = [this](Execute::Command &command, std::string &args, Execute::Response &output) {
+        command.Execute(*_pStorage, std::move(args), output);
+        if (output.Size() >= FLUSH_THRESHOLD && !send_response(_socket, output, true)) {
+            throw std::runtime_error("Failed to send response");
+        }
+    };
+
+    try {
+        ssize_t bytes = 0;
+        for (;;) {
+            if (_end == sizeof(_read_buffer) && _begin > 0) {
+                std::memmove(_read_buffer, _read_buffer + _begin, _end - _begin);
+                _end -= _begin;
+                _begin = 0;
+            }
+
+            // Data block is received right into the argument, large one doesn't go through the buffer at all
+            // once there is nothing else left in there
+            int flags = nonblock ? MSG_DONTWAIT : 0;
+            if (_begin == _end && _stream.Remains() >= sizeof(_read_buffer)) {
+                bytes = _stream.ReadArgument(
+                    [this, flags](char *into, std::size_t room) { return recv(_socket, into, room, flags); });
+            } else {
+                bytes = recv(_socket, _read_buffer + _end, sizeof(_read_buffer) - _end, flags);
+                _end += std::max<ssize_t>(bytes, 0);
+            }
+            if (bytes <= 0) {
+                break;
+            }
+            _logger->debug("Got {} bytes from socket", bytes);
+            _begin += _stream.Process(_read_buffer + _begin, _end - _begin, _output, execute);
+
+            // Whole buffer is free again once everything is processed, which is the common case
+            if (_begin == _end) {
+                _begin = _end = 0;
+            }
+
+            // Single send per read no matter how many commands it had
+            if (!send_response(_socket, _output)) {
+                throw std::runtime_error("Failed to send response");
+            }
+        }
+
+        if (bytes == 0) {
+            _logger->debug("Connection closed");
+        } else if (nonblock && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else {
+            throw std::runtime_error(std::string(strerror(errno)));
+        }
+    } catch (std::runtime_error &ex) {
+        _logger->error("Failed to process connection on descriptor {}: {}", _socket, ex.what());
+    } catch (std::bad_alloc &ex) {
+        // Connection holds whatever it has got so far, so releasing it is the way to get memory back
+        _logger->error("Out of memory on connection on descriptor {}", _socket);
+    }
+    return false;
+}
+
+} // namespace MTblocking
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,75 @@
+#ifndef AFINA_NETWORK_MT_BLOCKING_CONNECTION_H
+#define AFINA_NETWORK_MT_BLOCKING_CONNECTION_H
+
+#include <memory>
+#include <string>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include "network/CommandStream.h"
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Network {
+namespace MTblocking {
+
+/**
+ * # Client connection served by blocking worker
+ * Reads a chunk, executes all commands in it and sends their responses at once. Connection is served by
+ * a single thread at a time, but its state lives here rather than on the worker stack, so that idle
+ * connection could leave the thread in between of reads and be picked up by another one later
+ */
+class Connection {
+public:
+    Connection(int s, std::shared_ptr<Afina::Storage> ps, std::shared_ptr<spdlog::logger> pl)
+        : _socket(s), _pStorage(std::move(ps)), _logger(std::move(pl)), _begin(0), _end(0),
+          _stream(*_pStorage) {}
+
+    ~Connection();
+
+    /**
+     * Serve connection until client closes it or it fails, in which case false is returned. In nonblock
+     * mode method returns true as soon as there is nothing to read from the socket, responses are sent in
+     * the blocking way anyway
+     */
+    bool Serve(bool nonblock);
+
+    int Socket() const { return _socket; }
+
+private:
+    // Size of the chunk read from the socket at once
+    static const size_t READ_BUFFER_SIZE = 4096;
+
+    int _socket;
+
+    // afina services
+    std::shared_ptr<Afina::Storage> _pStorage;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Input is consumed in place: [begin, end) is not processed yet. Commands are parsed right from the buffer
+    // and the cursor moves over them, unprocessed tail is moved to the beginning only once there is no room
+    // left to read into
+    char _read_buffer[READ_BUFFER_SIZE];
+    std::size_t _begin;
+    std::size_t _end;
+
+    // Parse state of the stream
+    CommandStream _stream;
+
+    // Responses waiting to be sent
+    Execute::Response _output;
+};
+
+} // namespace MTblocking
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_MT_BLOCKING_CONNECTION_H
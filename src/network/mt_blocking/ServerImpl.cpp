@@ -1,13 +1,19 @@
 #include "ServerImpl.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
+#include <deque>
 #include <memory>
 #include <stdexcept>
 
 #include <netdb.h>
 #include <netinet/in.h>
 #include <csignal>
+#include <poll.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -15,11 +21,12 @@
 #include <spdlog/logger.h>
 
 #include <afina/Storage.h>
-#include <afina/execute/Command.h>
 #include <afina/logging/Service.h>
 #include <afina/concurrency/Executor.h>
 
-#include "protocol/Parser.h"
+#include "Connection.h"
+#include "network/Blocking.h"
+#include "network/Unix.h"
 
 
 namespace Afina {
@@ -28,12 +35,8 @@ namespace MTblocking {
 
 // See Server.h
 
-    ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl) : Server(std::move(ps), std::move(pl)),
-    _running(false), _server_socket(0) {}
-
-
-    ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl) : Server(std::move(ps), std::move(pl)),
-    _max_workers(0), _running(false), _server_socket(0), _current_workers(0) {}
+    ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl, std::shared_ptr<Config> pc) : Server(std::move(ps), std::move(pl), std::move(pc)),
+    _running(false), _server_socket(-1), _unix_socket(-1), _epoll_fd(-1) {}
 
 
 // See Server.h
@@ -54,31 +57,63 @@ ServerImpl::~ServerImpl() {}
         }
 
 
-        struct sockaddr_in server_addr{};
-        std::memset(&server_addr, 0, sizeof(server_addr));
-        server_addr.sin_family = AF_INET;         // IPv4
-        server_addr.sin_port = htons(port);       // TCP port number
-        server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
+        // Co-located clients could skip TCP stack entirely and use unix socket only, acceptor waits for
+        // any of listening sockets in poll() so they are non blocking
+        _server_socket = -1;
+        if (!pConfig->unix_only) {
+            struct sockaddr_in server_addr{};
+            std::memset(&server_addr, 0, sizeof(server_addr));
+            server_addr.sin_family = AF_INET;         // IPv4
+            server_addr.sin_port = htons(port);       // TCP port number
+            server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
 
-        _server_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-        if (_server_socket == -1) {
-            throw std::runtime_error("Failed to open socket");
-        }
+            _server_socket = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+            if (_server_socket == -1) {
+                throw std::runtime_error("Failed to open socket");
+            }
+
+            int opts = 1;
+            if (setsockopt(_server_socket, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1) {
+                close(_server_socket);
+                throw std::runtime_error("Socket setsockopt() failed");
+            }
 
-        int opts = 1;
-        if (setsockopt(_server_socket, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1) {
-            close(_server_socket);
-            throw std::runtime_error("Socket setsockopt() failed");
+            if (bind(_server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
+                close(_server_socket);
+                throw std::runtime_error("Socket bind() failed");
+            }
+
+            if (listen(_server_socket, 5) == -1) {
+                close(_server_socket);
+                throw std::runtime_error("Socket listen() failed");
+            }
         }
 
-        if (bind(_server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-            close(_server_socket);
-            throw std::runtime_error("Socket bind() failed");
+        _unix_socket = -1;
+        if (!pConfig->unix_socket.empty()) {
+            _unix_socket = make_unix_listen_socket(pConfig->unix_socket, SOCK_NONBLOCK);
         }
 
-        if (listen(_server_socket, 5) == -1) {
-            close(_server_socket);
-            throw std::runtime_error("Socket listen() failed");
+        // Idle connections wait for data in epoll rather than in read() on a worker thread, so the pool is
+        // taken only by connections which have something to execute
+        _epoll_fd = -1;
+        if (pConfig->park_idle) {
+            _epoll_fd = epoll_create1(0);
+            if (_epoll_fd == -1) {
+                throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
+            }
+
+            for (int *fd : {&_server_socket, &_unix_socket}) {
+                if (*fd < 0) {
+                    continue;
+                }
+                struct epoll_event event;
+                event.events = EPOLLIN;
+                event.data.ptr = fd;
+                if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, *fd, &event)) {
+                    throw std::runtime_error("Failed to add file descriptor to epoll");
+                }
+            }
         }
 
         _running.store(true);
@@ -98,6 +133,7 @@ ServerImpl::~ServerImpl() {}
         _logger->debug("Stopping server");
         _running.store(false);
         shutdown(_server_socket, SHUT_RDWR);
+        shutdown(_unix_socket, SHUT_RDWR);
         {
             std::unique_lock<std::mutex> l(_sockets_mutex);
             for (int &socket : sockets) {
@@ -112,103 +148,18 @@ ServerImpl::~ServerImpl() {}
     void ServerImpl::Join() {
         _executor->Stop(true);
         close(_server_socket);
+        close(_unix_socket);
         assert(_thread.joinable());
         _thread.join();
+        if (_epoll_fd != -1) {
+            close(_epoll_fd);
+        }
     }
 
+// See ServerImpl.h
     void ServerImpl::worker(int client_socket) {
-        // Here is connection state
-        // - parser: parse state of the stream
-        // - command_to_execute: last command parsed out of stream
-        // - arg_remains: how many bytes to read from stream to get command argument
-        // - argument_for_command: buffer stores argument
-        std::size_t arg_remains = 0;
-        Protocol::Parser parser;
-        std::string argument_for_command;
-        std::unique_ptr<Execute::Command> command_to_execute;
-
-        try {
-            int readed_bytes = 0;
-            char client_buffer[4096] = "";
-            int bytes = 0;
-            while ((bytes = read(client_socket, client_buffer + readed_bytes, sizeof(client_buffer) - readed_bytes)) > 0) {
-                readed_bytes += bytes;
-                _logger->debug("Got {} bytes from socket", bytes);
-
-                // Single block of data readed from the socket could trigger inside actions a multiple times,
-                // for example:
-                // - read#0: [<command1 start>]
-                // - read#1: [<command1 end> <argument> <command2> <argument for command 2> <command3> ... ]
-                while (readed_bytes > 0) {
-                    _logger->debug("Process {} bytes", readed_bytes);
-                    // There is no command yet
-                    if (!command_to_execute) {
-                        std::size_t parsed = 0;
-                        if (parser.Parse(client_buffer, readed_bytes, parsed)) {
-                            // There is no command to be launched, continue to parse input stream
-                            // Here we are, current chunk finished some command, process it
-                            _logger->debug("Found new command: {} in {} bytes", parser.Name(), parsed);
-                            command_to_execute = parser.Build(arg_remains);
-                            if (arg_remains > 0) {
-                                arg_remains += 2;
-                            }
-                        }
-
-                        // Parsed might fails to consume any bytes from input stream. In real life that could happens,
-                        // for example, because we are working with UTF-16 chars and only 1 byte left in stream
-                        if (parsed == 0) {
-                            break;
-                        } else {
-                            std::memmove(client_buffer, client_buffer + parsed, readed_bytes - parsed);
-                            readed_bytes -= parsed;
-                        }
-                    }
-
-                    // There is command, but we still wait for argument to arrive...
-                    if (command_to_execute && arg_remains > 0) {
-                        _logger->debug("Fill argument: {} bytes of {}", readed_bytes, arg_remains);
-                        // There is some parsed command, and now we are reading argument
-                        std::size_t to_read = std::min(arg_remains, std::size_t(readed_bytes));
-                        argument_for_command.append(client_buffer, to_read);
-
-                        std::memmove(client_buffer, client_buffer + to_read, readed_bytes - to_read);
-                        arg_remains -= to_read;
-                        readed_bytes -= to_read;
-                    }
-
-                    // Thre is command & argument - RUN!
-                    if (command_to_execute && arg_remains == 0) {
-                        _logger->debug("Start command execution");
-
-                        std::string result;
-                        command_to_execute->Execute(*pStorage, argument_for_command, result);
-
-                        // Send response
-                        result += "\r\n";
-                        if (send(client_socket, result.data(), result.size(), 0) <= 0) {
-                            throw std::runtime_error("Failed to send response");
-                        }
-
-                        // Prepare for the next command
-                        command_to_execute.reset();
-                        argument_for_command.resize(0);
-                        parser.Reset();
-                    }
-                } // while (readed_bytes)
-            }
-
-            if (readed_bytes == 0) {
-                _logger->debug("Connection closed");
-            } else {
-                throw std::runtime_error(std::string(strerror(errno)));
-            }
-        } catch (std::runtime_error &ex) {
-            _logger->error("Failed to process connection on descriptor {}: {}", client_socket, ex.what());
-        }
-
-        // We are done with this connection
-        close(client_socket);
-        _logger->debug("Connection {} closed", client_socket);
+        Connection connection(client_socket, pStorage, _logger);
+        connection.Serve(false);
     }
 
 // See Server.h
@@ -222,38 +173,29 @@ ServerImpl::~ServerImpl() {}
         //Protocol::Parser parser;
         //std::string argument_for_command;
         //std::unique_ptr<Execute::Command> command_to_execute;
+        if (pConfig->park_idle) {
+            OnRunParked();
+            return;
+        }
+
+        // Either of sockets might be missing, poll() skips negative descriptors
+        struct pollfd listeners[2];
+        listeners[0].fd = _server_socket;
+        listeners[1].fd = _unix_socket;
+        listeners[0].events = listeners[1].events = POLLIN;
         while (_running.load()) {
             _logger->debug("waiting for connection...");
 
-            // The call to accept() blocks until the incoming connection arrives
-            int client_socket;
-            struct sockaddr client_addr{};
-            socklen_t client_addr_len = sizeof(client_addr);
-            if ((client_socket = accept(_server_socket, (struct sockaddr *)&client_addr, &client_addr_len)) == -1) {
+            // The call to poll() blocks until the incoming connection arrives to any of listening sockets,
+            // stop wakes it up by shutting them down
+            if (poll(listeners, 2, -1) <= 0 || !_running.load()) {
                 continue;
             }
 
-
-            // Got new connection
-            if (_logger->should_log(spdlog::level::debug)) {
-                std::string host = "unknown", port = "-1";
-
-                char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
-                if (getnameinfo(&client_addr, client_addr_len, hbuf, sizeof(hbuf), sbuf, sizeof(sbuf),
-                                NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
-                    host = hbuf;
-                    port = sbuf;
-                }
-                _logger->debug("Accepted connection on descriptor {} (host={}, port={})\n", client_socket, host, port);
-            }
-
-
-            // Configure read timeout
-            {
-                struct timeval tv{};
-                tv.tv_sec = 5; // TODO: make it configurable
-                tv.tv_usec = 0;
-                setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv, sizeof tv);
+            int server_socket = (listeners[0].revents != 0) ? listeners[0].fd : listeners[1].fd;
+            int client_socket = AcceptConnection(server_socket);
+            if (client_socket == -1) {
+                continue;
             }
 
             sockets.push_back(client_socket);
@@ -268,8 +210,153 @@ ServerImpl::~ServerImpl() {}
         _logger->warn("Network stopped");
     }
 
+// See ServerImpl.h
+    void ServerImpl::OnRunParked() {
+        // Parked connections are checked for idleness a few times per timeout, the rest of time acceptor
+        // sleeps until there is something to dispatch
+        int timeout = -1;
+        if (pConfig->idle_timeout > 0) {
+            timeout = std::max<int>(1, pConfig->idle_timeout / 4);
+        }
+        auto last_check = std::chrono::steady_clock::now();
 
+        // Readable connections pool had no room for yet, they are retried shortly in order of arrival
+        std::deque<Connection *> backlog;
 
+        std::array<struct epoll_event, 64> events;
+        while (_running.load()) {
+            while (!backlog.empty() && _executor->Execute(&ServerImpl::serve, this, backlog.front())) {
+                backlog.pop_front();
+            }
+
+            int n = epoll_wait(_epoll_fd, &events[0], events.size(), backlog.empty() ? timeout : 1);
+            if (n == -1) {
+                if (errno != EINTR) {
+                    _logger->error("Failed to wait for events: {}", strerror(errno));
+                }
+                continue;
+            }
+            if (!_running.load()) {
+                break;
+            }
+
+            for (int i = 0; i < n; i++) {
+                void *ptr = events[i].data.ptr;
+                if (ptr == &_server_socket || ptr == &_unix_socket) {
+                    int client_socket = AcceptConnection(*static_cast<int *>(ptr));
+                    if (client_socket != -1) {
+                        Park(new Connection(client_socket, pStorage, _logger), EPOLL_CTL_ADD);
+                    }
+                    continue;
+                }
+
+                // Connection is registered as one shot, so it isn't reported again until worker parks it back
+                auto pc = static_cast<Connection *>(ptr);
+                {
+                    std::unique_lock<std::mutex> l(_sockets_mutex);
+                    _parked.erase(pc);
+                }
+                if (!backlog.empty() || !_executor->Execute(&ServerImpl::serve, this, pc)) {
+                    _logger->debug("No workers left to serve connection on descriptor {}", pc->Socket());
+                    backlog.push_back(pc);
+                }
+            }
+
+            // Nobody is blocked in read() on parked connection, so SO_RCVTIMEO doesn't work for them
+            auto now = std::chrono::steady_clock::now();
+            if (timeout > 0 && now - last_check >= std::chrono::milliseconds(timeout)) {
+                last_check = now;
+                auto deadline = now - std::chrono::milliseconds(pConfig->idle_timeout);
+
+                std::unique_lock<std::mutex> l(_sockets_mutex);
+                for (auto it = _parked.begin(); it != _parked.end();) {
+                    if (it->second < deadline) {
+                        _logger->debug("Close idle connection on descriptor {}", it->first->Socket());
+                        epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, it->first->Socket(), nullptr);
+                        delete it->first;
+                        it = _parked.erase(it);
+                    } else {
+                        it++;
+                    }
+                }
+            }
+        }
+
+        // Connections being served are closed by workers once they see server is stopped
+        for (Connection *pc : backlog) {
+            delete pc;
+        }
+        std::unique_lock<std::mutex> l(_sockets_mutex);
+        for (auto &parked : _parked) {
+            delete parked.first;
+        }
+        _parked.clear();
+        _logger->warn("Network stopped");
+    }
+
+// See ServerImpl.h
+    int ServerImpl::AcceptConnection(int server_socket) {
+        int client_socket;
+        struct sockaddr_storage client_addr{};
+        socklen_t client_addr_len = sizeof(client_addr);
+        if ((client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_addr_len)) == -1) {
+            return -1;
+        }
+
+        // Got new connection
+        if (_logger->should_log(spdlog::level::debug)) {
+            std::string host = "unknown", port = "-1";
+
+            char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
+            if (getnameinfo((struct sockaddr *)&client_addr, client_addr_len, hbuf, sizeof(hbuf), sbuf, sizeof(sbuf),
+                            NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+                host = hbuf;
+                port = sbuf;
+            }
+            _logger->debug("Accepted connection on descriptor {} (host={}, port={})\n", client_socket, host, port);
+        }
+
+        // Configure read timeout
+        if (pConfig->idle_timeout > 0) {
+            struct timeval tv{};
+            tv.tv_sec = pConfig->idle_timeout / 1000;
+            tv.tv_usec = (pConfig->idle_timeout % 1000) * 1000;
+            setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv, sizeof tv);
+        }
+
+        set_tcp_nodelay(client_socket, client_addr);
+        return client_socket;
+    }
+
+// See ServerImpl.h
+    void ServerImpl::Park(Connection *pc, int op) {
+        std::unique_lock<std::mutex> l(_sockets_mutex);
+        if (!_running.load()) {
+            delete pc;
+            return;
+        }
+
+        // Connection is published first, so that acceptor finds it once epoll reports the socket
+        _parked[pc] = std::chrono::steady_clock::now();
+
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = pc;
+        if (epoll_ctl(_epoll_fd, op, pc->Socket(), &event)) {
+            _logger->error("Failed to park connection on descriptor {}: {}", pc->Socket(), strerror(errno));
+            _parked.erase(pc);
+            delete pc;
+        }
+    }
+
+// See ServerImpl.h
+    void ServerImpl::serve(Connection *pc) {
+        if (pc->Serve(true)) {
+            Park(pc, EPOLL_CTL_MOD);
+        } else {
+            delete pc;
+        }
+    }
 
 } // namespace MTblocking
 } // namespace Network
@@ -2,7 +2,9 @@
 #define AFINA_NETWORK_MT_BLOCKING_SERVER_H
 
 #include <atomic>
+#include <chrono>
 #include <thread>
+#include <unordered_map>
 
 #include <afina/network/Server.h>
 #include <afina/concurrency/Executor.h>
@@ -15,13 +17,21 @@ namespace Afina {
 namespace Network {
 namespace MTblocking {
 
+// Forward declaration, see Connection.h
+class Connection;
+
 /**
  * # Network resource manager implementation
  * Server that is spawning a separate thread for each connection
+ *
+ * With park_idle connection holds a thread only while it has something to read: in between acceptor keeps it
+ * in epoll and hands it over to the pool once socket gets readable. Worker reads and executes commands the
+ * blocking way, until socket is drained, then parks connection back. So number of connections is no longer
+ * limited by number of threads
  */
 class ServerImpl : public Server {
 public:
-    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl);
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl, std::shared_ptr<Config> pc);
     ~ServerImpl();
 
     // See Server.h
@@ -39,10 +49,29 @@ protected:
      */
     void OnRun();
 
+    /**
+     * Acceptor loop with park_idle: accept new connections and dispatch parked ones once they got readable
+     */
+    void OnRunParked();
+
+    /**
+     * Accept connection on the given listening socket and configure it, returns -1 on failure
+     */
+    int AcceptConnection(int server_socket);
+
+    /**
+     * Let connection wait for data in epoll, op is either EPOLL_CTL_ADD for a new connection or EPOLL_CTL_MOD
+     * to rearm one shot registration of the existing one. Connection is deleted if server is stopped
+     */
+    void Park(Connection *pc, int op);
+
 private:
 
     void worker(int client_socket);
 
+    // Pool task serving readable parked connection until its socket is drained
+    void serve(Connection *pc);
+
     // Logger instance
     std::shared_ptr<spdlog::logger> _logger;
 
@@ -57,9 +86,18 @@ private:
     // Server socket to accept connections on
     int _server_socket;
 
+    // Unix domain socket to accept connections from the same host on, -1 if there is none
+    int _unix_socket;
+
+    // Epoll instance parked connections and listening sockets wait in, -1 if park_idle is off
+    int _epoll_fd;
+
     // Thread to run network on
     std::thread _thread;
 
+    // Connections waiting for data in epoll and the time they've been parked at, guarded by _sockets_mutex
+    std::unordered_map<Connection *, std::chrono::steady_clock::time_point> _parked;
+
     std::vector<int> sockets;
 
     std::unique_ptr<Afina::Concurrency::Executor> _executor;
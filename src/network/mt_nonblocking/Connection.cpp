@@ -1,25 +1,222 @@
 #include "Connection.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/Storage.h>
+#include <afina/execute/Stats.h>
 
 namespace Afina {
 namespace Network {
 namespace MTnonblock {
 
+// Commands answered with busy error, see Admission.h
+static std::atomic<int64_t> &ShedCommands() {
+    static std::atomic<int64_t> &counter = Execute::Stats::Counter("shed_commands");
+    return counter;
+}
+
+// See Connection.h
+Connection::~Connection() {
+    _output_size->fetch_sub(_accounted, std::memory_order_relaxed);
+    close(_socket);
+}
+
+// See Connection.h
+void Connection::Start() {
+    _logger->debug("Start connection on descriptor {}", _socket);
+    _alive = true;
+    _eof = false;
+    UpdateEvents();
+}
+
 // See Connection.h
-void Connection::Start() { std::cout << "Start" << std::endl; }
+void Connection::OnError() {
+    _logger->debug("Connection on descriptor {} failed", _socket);
+    _alive = false;
+    _ready = false;
+}
 
 // See Connection.h
-void Connection::OnError() { std::cout << "OnError" << std::endl; }
+void Connection::OnClose() {
+    _logger->debug("Connection on descriptor {} closed by client", _socket);
+    _alive = false;
+    _ready = false;
+}
 
 // See Connection.h
-void Connection::OnClose() { std::cout << "OnClose" << std::endl; }
+void Connection::OnTimeout() {
+    _logger->debug("Connection on descriptor {} is idle for too long", _socket);
+    _alive = false;
+    _ready = false;
+}
 
 // See Connection.h
-void Connection::DoRead() { std::cout << "DoRead" << std::endl; }
+void Connection::DoRead() {
+    std::size_t total = 0;
+    _ready = false;
+    for (;;) {
+        // Client might take responses right away, otherwise reading stops until it does. There could be more
+        // data in socket, which edge triggered epoll doesn't report again
+        if (Throttled() && (!Resume() || Throttled())) {
+            _ready = _alive && _edge_triggered;
+            break;
+        }
+
+        // Buffer is taken from pool of the worker only for the time there is something in it
+        std::size_t space = 0;
+        char *buffer = _input.Space(space);
+        ssize_t bytes = read(_socket, buffer, space);
+        _input.Commit(bytes > 0 ? bytes : 0);
+        if (bytes == 0) {
+            // Client is done with requests, but still waits for responses
+            _eof = true;
+            break;
+        } else if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                OnError();
+                return;
+            }
+            break;
+        }
+
+        _logger->debug("Got {} bytes from socket {}", bytes, _socket);
+        Process();
+
+        // Level triggered epoll reports socket again if there is something left, so single read is enough.
+        // Otherwise short read means socket is drained, new data will trigger new edge
+        total += bytes;
+        if (!_edge_triggered || std::size_t(bytes) < space) {
+            break;
+        } else if (total >= _read_budget) {
+            _ready = true;
+            break;
+        }
+    }
+
+    // Most of the time socket buffer has enough room for the whole response, so try to send it right away
+    // instead of going through one more epoll round
+    if (!Resume()) {
+        OnError();
+        return;
+    }
+    UpdateEvents();
+}
+
+// See Connection.h
+void Connection::Process() {
+    // Rest of commands waits in buffer until client takes responses
+    auto more = [this]() { return !Throttled(); };
+    auto execute = [this](Execute::Command &command, std::string &args, Execute::Response &output) {
+        if (_shed) {
+            output.Append("SERVER_ERROR busy\r\n");
+            ShedCommands().fetch_add(1, std::memory_order_relaxed);
+        } else {
+            command.Execute(*_pStorage, args, output);
+        }
+    };
+
+    while (!_input.Empty()) {
+        std::size_t size = 0;
+        const char *data = _input.Data(size);
+        std::size_t consumed = _stream.Process(data, size, _output, execute, more);
+        _input.Consume(consumed);
+        if (consumed < size) {
+            break;
+        }
+    }
+}
+
+// See Connection.h
+void Connection::DoWrite() {
+    if (!Resume()) {
+        OnError();
+        return;
+    }
+    UpdateEvents();
+}
+
+// See Connection.h
+bool Connection::Resume() {
+    for (;;) {
+        if (!Flush()) {
+            return false;
+        }
+
+        // Commands left in buffer once connection got throttled
+        std::size_t left = _input.Size();
+        if (left == 0 || Throttled()) {
+            return true;
+        }
+
+        Process();
+        if (_input.Size() == left) {
+            return true;
+        }
+    }
+}
+
+// See Connection.h
+bool Connection::Flush() {
+    struct iovec iov[64];
+    while (!_output.Empty()) {
+        ssize_t sent = writev(_socket, iov, _output.Prepare(iov, 64));
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        _output.Consume(sent);
+    }
+    return true;
+}
+
+// See Connection.h
+void Connection::UpdateEvents() {
+    Account();
+    bool want_write = !_output.Empty();
+    if (_eof && !want_write) {
+        _alive = false;
+        _ready = false;
+        return;
+    }
+
+    // Once reading is wanted again, epoll reports data which has arrived meanwhile even in edge triggered mode
+    bool want_read = !_eof && !Throttled();
+    _event.events = (want_read ? EPOLLIN : 0) | (want_write ? EPOLLOUT : 0) | (_edge_triggered ? EPOLLET : 0);
+    _ready = _ready && want_read;
+}
+
+// See Connection.h
+bool Connection::Throttled() {
+    std::size_t size = _output.Size();
+    if (size >= _high_watermark) {
+        _throttled = true;
+    } else if (size < _low_watermark) {
+        _throttled = false;
+    }
+
+    // Connection without pending responses doesn't hold any memory, so it is free to go on
+    return _throttled ||
+           (size > 0 && _output_limit > 0 && _output_size->load(std::memory_order_relaxed) >= _output_limit);
+}
 
 // See Connection.h
-void Connection::DoWrite() { std::cout << "DoWrite" << std::endl; }
+void Connection::Account() {
+    std::size_t size = _output.Size();
+    if (size > _accounted) {
+        _output_size->fetch_add(size - _accounted, std::memory_order_relaxed);
+    } else if (size < _accounted) {
+        _output_size->fetch_sub(_accounted - size, std::memory_order_relaxed);
+    }
+    _accounted = size;
+}
 
 } // namespace MTnonblock
 } // namespace Network
@@ -1,28 +1,74 @@
 #ifndef AFINA_NETWORK_MT_NONBLOCKING_CONNECTION_H
 #define AFINA_NETWORK_MT_NONBLOCKING_CONNECTION_H
 
+#include <atomic>
 #include <cstring>
+#include <memory>
+#include <string>
 
 #include <sys/epoll.h>
 
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+#include <afina/network/Config.h>
+
+#include "network/BufferPool.h"
+#include "network/CommandStream.h"
+#include "network/TimerWheel.h"
+
+namespace spdlog {
+class logger;
+}
+
 namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
 namespace Network {
 namespace MTnonblock {
 
+/**
+ * # Client connection state machine
+ * Connection is registered in epoll with EPOLLONESHOT, so at any given moment there is at most one worker
+ * running its methods and no locking is required. Once worker is done it asks connection for the events
+ * to rearm: reading is wanted until client closes its side, writing only while there are pending responses.
+ *
+ * In edge triggered mode connection reads until socket is drained or read budget is exhausted. In the last
+ * case connection is marked as ready: there could be more data which epoll is not going to report again
+ *
+ * Connection stops executing and reading commands once its responses hit the high watermark, or there are
+ * too many responses not sent in all connections together, and resumes after client takes them.
+ *
+ * Commands completed while worker is overloaded are not executed at all, client gets busy error instead
+ */
 class Connection {
 public:
-    Connection(int s) : _socket(s) {
+    Connection(int s, std::shared_ptr<Afina::Storage> ps, std::shared_ptr<spdlog::logger> pl, const Config &config,
+               std::atomic<std::size_t> *output_size)
+        : _socket(s), _pStorage(std::move(ps)), _logger(std::move(pl)), _edge_triggered(config.edge_triggered),
+          _read_budget(config.read_budget), _high_watermark(config.output_high_watermark),
+          _low_watermark(config.output_low_watermark), _output_limit(config.output_limit), _output_size(output_size),
+          _alive(false), _eof(false), _ready(false), _in_ready(false), _throttled(false), _shed(false),
+          _stream(*_pStorage), _accounted(0), _wheel(this), _period(0), _wakeups(0),
+          _next_migrated(nullptr) {
         std::memset(&_event, 0, sizeof(struct epoll_event));
         _event.data.ptr = this;
     }
 
-    inline bool isAlive() const { return true; }
+    ~Connection();
+
+    inline bool isAlive() const { return _alive; }
+
+    // Connection has stopped reading because of budget, not because socket is drained
+    inline bool isReady() const { return _ready; }
 
     void Start();
 
 protected:
     void OnError();
     void OnClose();
+    void OnTimeout();
     void DoRead();
     void DoWrite();
 
@@ -30,8 +76,97 @@ private:
     friend class Worker;
     friend class ServerImpl;
 
+    /**
+     * Execute all complete commands in the read buffer
+     */
+    void Process();
+
+    /**
+     * Try to send pending responses without blocking, returns false if connection is broken
+     */
+    bool Flush();
+
+    /**
+     * Send pending responses and execute commands left in read buffer while they fit under output limits,
+     * returns false if connection is broken
+     */
+    bool Resume();
+
+    /**
+     * Recalculates events connection is interested in
+     */
+    void UpdateEvents();
+
+    /**
+     * Checks if connection must stop executing commands until responses are sent
+     */
+    bool Throttled();
+
+    /**
+     * Reflect changes in size of the output queue in total size of all connections
+     */
+    void Account();
+
     int _socket;
     struct epoll_event _event;
+
+    // afina services
+    std::shared_ptr<Afina::Storage> _pStorage;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Epoll mode, see Config.h
+    bool _edge_triggered;
+    std::size_t _read_budget;
+
+    // Output limits, see Config.h
+    std::size_t _high_watermark;
+    std::size_t _low_watermark;
+    std::size_t _output_limit;
+
+    // Total size of responses in all connections of the server
+    std::atomic<std::size_t> *_output_size;
+
+    // Connection could be served further
+    bool _alive;
+
+    // Client has closed its side, connection gets closed once all responses are sent
+    bool _eof;
+
+    // There could be more data in socket to read
+    bool _ready;
+
+    // Connection has an entry in ready list of its owner. Closed connection is released only once owner
+    // gets to that entry
+    bool _in_ready;
+
+    // Output queue has hit high watermark and hasn't gone below low one yet
+    bool _throttled;
+
+    // Worker sheds the round connection is served in, commands are answered with busy error, see Admission.h
+    bool _shed;
+
+    // Bytes read from the socket but not processed yet, holds pooled memory only while not empty. Chunks
+    // go back to pool of the worker serving connection at the moment
+    ReadBuffer _input;
+
+    // Parse state of the stream
+    CommandStream _stream;
+
+    // Responses waiting to be sent
+    Execute::Response _output;
+
+    // Part of _output_size contributed by this connection
+    std::size_t _accounted;
+
+    // Position in the idle connections timing wheel
+    TimerWheel::Entry _wheel;
+
+    // Number of times connection has been served during worker balancing period, see Worker
+    unsigned _period;
+    std::size_t _wakeups;
+
+    // Next connection in inbox of the worker connection is moved to
+    Connection *_next_migrated;
 };
 
 } // namespace MTnonblock
@@ -1,5 +1,6 @@
 #include "ServerImpl.h"
 
+#include <array>
 #include <cassert>
 #include <cstring>
 #include <iostream>
@@ -12,6 +13,7 @@
 #include <signal.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -24,13 +26,17 @@
 #include "Connection.h"
 #include "Utils.h"
 #include "Worker.h"
+#include "network/Unix.h"
 
 namespace Afina {
 namespace Network {
 namespace MTnonblock {
 
 // See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl) : Server(ps, pl) {}
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl,
+                       std::shared_ptr<Config> pc)
+    : Server(ps, pl, pc), _server_socket(-1), _unix_socket(-1), _data_epoll_fd(-1), _event_fd(-1), _output_size(0),
+      _idle(pc->reuseport ? 0 : pc->idle_timeout), _acceptors_running(0), _draining(false) {}
 
 // See Server.h
 ServerImpl::~ServerImpl() {}
@@ -47,33 +53,70 @@ void ServerImpl::Start(uint16_t port, uint32_t n_acceptors, uint32_t n_workers)
         throw std::runtime_error("Unable to mask SIGPIPE");
     }
 
-    // Create server socket
-    struct sockaddr_in server_addr;
-    std::memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;         // IPv4
-    server_addr.sin_port = htons(port);       // TCP port number
-    server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
+    // Each client takes a descriptor, so default soft limit of 1024 is far too low for
+    // the number of connections server is expected to handle
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0 && nofile.rlim_cur < nofile.rlim_max) {
+        nofile.rlim_cur = nofile.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &nofile) != 0) {
+            _logger->warn("Failed to raise open files limit: {}", strerror(errno));
+        }
+    }
 
-    _server_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (_server_socket == -1) {
-        throw std::runtime_error("Failed to open socket: " + std::string(strerror(errno)));
+    _event_fd = eventfd(0, EFD_NONBLOCK);
+    if (_event_fd == -1) {
+        throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
     }
 
-    int opts = 1;
-    if (setsockopt(_server_socket, SOL_SOCKET, (SO_KEEPALIVE), &opts, sizeof(opts)) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket setsockopt() failed: " + std::string(strerror(errno)));
+    _unix_socket = -1;
+    if (!pConfig->unix_socket.empty()) {
+        _unix_socket = UnixListenSocket();
     }
 
-    if (bind(_server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket bind() failed: " + std::string(strerror(errno)));
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+
+    // Each worker accepts connections on its own socket and never shares them with others, so there is
+    // no need in acceptor threads
+    if (pConfig->reuseport) {
+        _server_socket = -1;
+        // Workers could move connections to each other, so all of them must exist before any starts
+        _workers.reserve(n_workers);
+        for (int i = 0; i < n_workers; i++) {
+            _workers.emplace_back(pStorage, pLogging, pConfig, &_output_size);
+        }
+
+        for (int i = 0; i < n_workers; i++) {
+            int epoll_fd = epoll_create1(0);
+            if (epoll_fd == -1) {
+                throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
+            }
+            _worker_epoll_fds.push_back(epoll_fd);
+
+            // Worker keeps running after stop while its connections drain, so single wakeup is enough
+            struct epoll_event stop_event = event;
+            stop_event.events |= EPOLLET;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, _event_fd, &stop_event)) {
+                throw std::runtime_error("Failed to add eventfd descriptor to epoll");
+            }
+
+            // Unix socket has no SO_REUSEPORT, so workers share it
+            std::vector<int> listen_sockets;
+            if (!pConfig->unix_only) {
+                _worker_sockets.push_back(ListenSocket(port, true));
+                listen_sockets.push_back(_worker_sockets.back());
+            }
+            if (_unix_socket >= 0) {
+                listen_sockets.push_back(_unix_socket);
+            }
+            _workers[i].Start(epoll_fd, listen_sockets, &_workers);
+        }
+        return;
     }
 
-    make_socket_non_blocking(_server_socket);
-    if (listen(_server_socket, 5) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket listen() failed: " + std::string(strerror(errno)));
+    if (!pConfig->unix_only) {
+        _server_socket = ListenSocket(port, false);
     }
 
     // Start IO workers
@@ -82,25 +125,16 @@ void ServerImpl::Start(uint16_t port, uint32_t n_acceptors, uint32_t n_workers)
         throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
     }
 
-    _event_fd = eventfd(0, EFD_NONBLOCK);
-    if (_event_fd == -1) {
-        throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
-    }
-
-    struct epoll_event event;
-    event.events = EPOLLIN;
-    event.data.ptr = nullptr;
-    if (epoll_ctl(_data_epoll_fd, EPOLL_CTL_ADD, _event_fd, &event)) {
-        throw std::runtime_error("Failed to add eventfd descriptor to epoll");
-    }
-
+    // Workers get eventfd only once connections are drained on stop, see WakeWorkers()
     _workers.reserve(n_workers);
     for (int i = 0; i < n_workers; i++) {
-        _workers.emplace_back(pStorage, pLogging);
-        _workers.back().Start(_data_epoll_fd);
+        _workers.emplace_back(pStorage, pLogging, pConfig, &_output_size);
+        _workers.back().Start(_data_epoll_fd, this);
     }
 
     // Start acceptors
+    _acceptors_running = n_acceptors;
+    _draining = false;
     _acceptors.reserve(n_acceptors);
     for (int i = 0; i < n_acceptors; i++) {
         _acceptors.emplace_back(&ServerImpl::OnRun, this);
@@ -119,6 +153,13 @@ void ServerImpl::Stop() {
     if (eventfd_write(_event_fd, 1)) {
         throw std::runtime_error("Failed to wakeup workers");
     }
+
+    // Without acceptors shared epoll never gets any connections
+    if (_data_epoll_fd >= 0 && _acceptors.empty()) {
+        std::lock_guard<std::mutex> lock(_lock);
+        _draining = true;
+        WakeWorkers();
+    }
 }
 
 // See Server.h
@@ -130,6 +171,68 @@ void ServerImpl::Join() {
     for (auto &w : _workers) {
         w.Join();
     }
+
+    if (_server_socket >= 0) {
+        close(_server_socket);
+        _server_socket = -1;
+    }
+    if (_unix_socket >= 0) {
+        close(_unix_socket);
+        _unix_socket = -1;
+    }
+    for (int fd : _worker_sockets) {
+        close(fd);
+    }
+    for (int fd : _worker_epoll_fds) {
+        close(fd);
+    }
+    _worker_sockets.clear();
+    _worker_epoll_fds.clear();
+
+    if (_data_epoll_fd >= 0) {
+        close(_data_epoll_fd);
+        _data_epoll_fd = -1;
+    }
+    if (_event_fd >= 0) {
+        close(_event_fd);
+        _event_fd = -1;
+    }
+}
+
+// See Server.h
+std::vector<int> ServerImpl::ListenSockets() const {
+    std::vector<int> result = _worker_sockets;
+    for (int fd : {_server_socket, _unix_socket}) {
+        if (fd >= 0) {
+            result.push_back(fd);
+        }
+    }
+    return result;
+}
+
+// See ServerImpl.h
+int ServerImpl::ListenSocket(uint16_t port, bool reuseport) {
+    // Socket handed over by the previous instance is already bound and listening
+    int fd = pConfig->TakeListenSocket(AF_INET);
+    if (fd < 0) {
+        return make_listen_socket(port, reuseport);
+    }
+
+    _logger->warn("Use inherited listening socket {}", fd);
+    make_socket_non_blocking(fd);
+    return fd;
+}
+
+// See ServerImpl.h
+int ServerImpl::UnixListenSocket() {
+    int fd = pConfig->TakeListenSocket(AF_UNIX);
+    if (fd < 0) {
+        return make_unix_listen_socket(pConfig->unix_socket, SOCK_NONBLOCK);
+    }
+
+    _logger->warn("Use inherited unix listening socket {}", fd);
+    make_socket_non_blocking(fd);
+    return fd;
 }
 
 // See ServerImpl.h
@@ -140,11 +243,13 @@ void ServerImpl::OnRun() {
         throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
     }
 
-    struct epoll_event event;
-    event.events = EPOLLIN | EPOLLEXCLUSIVE;
-    event.data.fd = _server_socket;
-    if (epoll_ctl(acceptor_epoll, EPOLL_CTL_ADD, _server_socket, &event)) {
-        throw std::runtime_error("Failed to add file descriptor to epoll");
+    for (int fd : {_server_socket, _unix_socket}) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.fd = fd;
+        if (fd >= 0 && epoll_ctl(acceptor_epoll, EPOLL_CTL_ADD, fd, &event)) {
+            throw std::runtime_error("Failed to add file descriptor to epoll");
+        }
     }
 
     struct epoll_event event2;
@@ -157,7 +262,13 @@ void ServerImpl::OnRun() {
     bool run = true;
     std::array<struct epoll_event, 64> mod_list;
     while (run) {
-        int nmod = epoll_wait(acceptor_epoll, &mod_list[0], mod_list.size(), -1);
+        // Acceptors also look after idle connections, wheel tells when to wake up for that
+        int timeout;
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            timeout = _idle.Timeout();
+        }
+        int nmod = epoll_wait(acceptor_epoll, &mod_list[0], mod_list.size(), timeout);
         _logger->debug("Acceptor wokeup: {} events", nmod);
 
         for (int i = 0; i < nmod; i++) {
@@ -169,12 +280,13 @@ void ServerImpl::OnRun() {
             }
 
             for (;;) {
-                struct sockaddr in_addr;
+                struct sockaddr_storage in_addr;
                 socklen_t in_len;
 
                 // No need to make these sockets non blocking since accept4() takes care of it.
                 in_len = sizeof in_addr;
-                int infd = accept4(_server_socket, &in_addr, &in_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                int infd = accept4(current_event.data.fd, (struct sockaddr *)&in_addr, &in_len,
+                                   SOCK_NONBLOCK | SOCK_CLOEXEC);
                 if (infd == -1) {
                     if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
                         break; // We have processed all incoming connections.
@@ -185,36 +297,117 @@ void ServerImpl::OnRun() {
                 }
 
                 // Print host and service info.
-                char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
-                int retval = getnameinfo(&in_addr, in_len, hbuf, sizeof hbuf, sbuf, sizeof sbuf,
-                                         NI_NUMERICHOST | NI_NUMERICSERV);
-                if (retval == 0) {
-                    _logger->info("Accepted connection on descriptor {} (host={}, port={})\n", infd, hbuf, sbuf);
+                if (_logger->should_log(spdlog::level::debug)) {
+                    char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
+                    int retval = getnameinfo((struct sockaddr *)&in_addr, in_len, hbuf, sizeof hbuf, sbuf,
+                                             sizeof sbuf, NI_NUMERICHOST | NI_NUMERICSERV);
+                    if (retval == 0) {
+                        _logger->debug("Accepted connection on descriptor {} (host={}, port={})\n", infd, hbuf, sbuf);
+                    }
                 }
 
-                // Register the new FD to be monitored by epoll.
-                Connection *pc = new Connection(infd);
-                if (pc == nullptr) {
-                    throw std::runtime_error("Failed to allocate connection");
+                if (pConfig->socket_busy_poll > 0 && !set_socket_busy_poll(infd, pConfig->socket_busy_poll)) {
+                    _logger->debug("Failed to set busy poll on descriptor {}: {}", infd, strerror(errno));
                 }
 
-                // Register connection in worker's epoll
+                // Register the new FD to be monitored by epoll.
+                Connection *pc = new Connection(infd, pStorage, _logger, *pConfig, &_output_size);
+
+                // Register connection in worker's epoll. Wheel gets it first: once registered, connection could
+                // be closed by some worker at any moment
                 pc->Start();
                 if (pc->isAlive()) {
                     pc->_event.events |= EPOLLONESHOT;
+                    {
+                        std::lock_guard<std::mutex> lock(_lock);
+                        _connections.insert(pc);
+                        _idle.Update();
+                        _idle.Add(&pc->_wheel);
+                    }
+
                     int epoll_ctl_retval;
                     if ((epoll_ctl_retval = epoll_ctl(_data_epoll_fd, EPOLL_CTL_ADD, pc->_socket, &pc->_event))) {
                         _logger->debug("epoll_ctl failed during connection register in workers'epoll: error {}", epoll_ctl_retval);
+                        {
+                            std::lock_guard<std::mutex> lock(_lock);
+                            _connections.erase(pc);
+                            _idle.Remove(&pc->_wheel);
+                        }
                         pc->OnError();
                         delete pc;
                     }
+                } else {
+                    delete pc;
                 }
             }
         }
+
+        OnIdle();
     }
+
+    close(acceptor_epoll);
+    OnAcceptorStopped();
     _logger->warn("Acceptor stopped");
 }
 
+// See ServerImpl.h
+void ServerImpl::OnIdle() {
+    std::vector<TimerWheel::Entry *> expired;
+    std::lock_guard<std::mutex> lock(_lock);
+    _idle.Update();
+    _idle.Expire(expired);
+
+    // Worker removes connection from the wheel before it closes socket, so lock keeps descriptors valid here
+    for (TimerWheel::Entry *entry : expired) {
+        Connection *pc = static_cast<Connection *>(entry->owner);
+        _logger->debug("Connection on descriptor {} is idle for too long", pc->_socket);
+        shutdown(pc->_socket, SHUT_RDWR);
+    }
+}
+
+// See ServerImpl.h
+void ServerImpl::OnAcceptorStopped() {
+    std::lock_guard<std::mutex> lock(_lock);
+
+    // Commands which have already arrived are still read, then connection sees end of stream and gets closed
+    // once all responses are sent. Connections accepted by other acceptors later on are shut down by them
+    _logger->debug("Stop acceptor, {} connections left", _connections.size());
+    for (Connection *pc : _connections) {
+        shutdown(pc->_socket, SHUT_RD);
+    }
+
+    if (--_acceptors_running == 0) {
+        _draining = true;
+        if (_connections.empty()) {
+            WakeWorkers();
+        }
+    }
+}
+
+// See ServerImpl.h
+void ServerImpl::Touch(Connection *pc) { _idle.Touch(&pc->_wheel, TimerWheel::Now()); }
+
+// See ServerImpl.h
+void ServerImpl::Release(Connection *pc) {
+    std::lock_guard<std::mutex> lock(_lock);
+    _connections.erase(pc);
+    _idle.Remove(&pc->_wheel);
+    if (_draining && _connections.empty()) {
+        WakeWorkers();
+    }
+}
+
+// See ServerImpl.h
+void ServerImpl::WakeWorkers() {
+    // Event stays readable, so every worker sees it
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(_data_epoll_fd, EPOLL_CTL_ADD, _event_fd, &event)) {
+        _logger->error("Failed to add eventfd descriptor to epoll: {}", strerror(errno));
+    }
+}
+
 } // namespace MTnonblock
 } // namespace Network
 } // namespace Afina
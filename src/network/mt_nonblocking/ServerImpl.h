@@ -1,11 +1,16 @@
 #ifndef AFINA_NETWORK_MT_NONBLOCKING_SERVER_H
 #define AFINA_NETWORK_MT_NONBLOCKING_SERVER_H
 
+#include <atomic>
+#include <mutex>
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include <afina/network/Server.h>
 
+#include "network/TimerWheel.h"
+
 namespace spdlog {
 class logger;
 }
@@ -14,16 +19,21 @@ namespace Afina {
 namespace Network {
 namespace MTnonblock {
 
-// Forward declaration, see Worker.h
+// Forward declarations, see Connection.h and Worker.h
+class Connection;
 class Worker;
 
 /**
  * # Network resource manager implementation
  * Epoll based server
+ *
+ * Connections of epoll shared between workers are owned by server: acceptors register them, workers
+ * release ones they close. On stop acceptors shut down reading side of every connection, workers keep
+ * serving them until all responses are sent and exit once server has no connections left
  */
 class ServerImpl : public Server {
 public:
-    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl);
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl, std::shared_ptr<Config> pc);
     ~ServerImpl();
 
     // See Server.h
@@ -35,10 +45,51 @@ public:
     // See Server.h
     void Join() override;
 
+    // See Server.h
+    std::vector<int> ListenSockets() const override;
+
+    /**
+     * Record activity on connection of shared epoll, called by workers without locking
+     */
+    void Touch(Connection *pc);
+
+    /**
+     * Forget connection of shared epoll worker is about to close. Once the last one is gone while server
+     * is stopping, workers are woken up to exit
+     */
+    void Release(Connection *pc);
+
 protected:
     void OnRun();
     void OnNewConnection();
 
+    /**
+     * Shut down connections of shared epoll which are idle for too long. Connection could be served by some
+     * worker right now, so it isn't closed here: socket reports hang up and the worker getting that closes it
+     */
+    void OnIdle();
+
+    /**
+     * Called by acceptor once it has stopped: shut down reading side of connections, which get closed once
+     * their responses are sent. The last acceptor starts waiting for connections to drain
+     */
+    void OnAcceptorStopped();
+
+    /**
+     * Let workers of shared epoll exit, must be called under _lock
+     */
+    void WakeWorkers();
+
+    /**
+     * Returns listening socket inherited from the previous instance if there is one left, opens new one otherwise
+     */
+    int ListenSocket(uint16_t port, bool reuseport);
+
+    /**
+     * Same as ListenSocket, but for unix domain socket at Config::unix_socket
+     */
+    int UnixListenSocket();
+
 private:
     // logger to use
     std::shared_ptr<spdlog::logger> _logger;
@@ -51,6 +102,10 @@ private:
     // Socket to accept new connection on, shared between acceptors
     int _server_socket;
 
+    // Unix domain socket to accept connections from the same host on, shared between acceptors or
+    // workers, -1 if there is none
+    int _unix_socket;
+
     // Threads that accepts new connections, each has private epoll instance
     // but share global server socket
     std::vector<std::thread> _acceptors;
@@ -63,6 +118,24 @@ private:
 
     // threads serving read/write requests
     std::vector<Worker> _workers;
+
+    // Total size of responses not sent yet, see Config::output_limit
+    std::atomic<std::size_t> _output_size;
+
+    // Connections of shared epoll and their idle timing wheel, moved by acceptors. Workers record activity
+    // without locking and take lock only to release connections they close. Not used with Config::reuseport,
+    // workers own their connections then
+    std::unordered_set<Connection *> _connections;
+    TimerWheel _idle;
+    std::mutex _lock;
+
+    // Number of acceptors not stopped yet and flag that all of them have, guarded by _lock
+    std::size_t _acceptors_running;
+    bool _draining;
+
+    // Listening sockets and epoll instances owned by workers, used only with Config::reuseport
+    std::vector<int> _worker_sockets;
+    std::vector<int> _worker_epoll_fds;
 };
 
 } // namespace MTnonblock
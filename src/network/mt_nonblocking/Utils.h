@@ -1,12 +1,29 @@
 #ifndef AFINA_NETWORK_MT_NONBLOCKING_UTILS_H
 #define AFINA_NETWORK_MT_NONBLOCKING_UTILS_H
 
+#include <cstdint>
+
+#include <sys/socket.h>
+
 namespace Afina {
 namespace Network {
 namespace MTnonblock {
 
 void make_socket_non_blocking(int sfd);
 
+/**
+ * Creates socket listening for TCP connections on the given port, flags are added to socket type (SOCK_NONBLOCK,
+ * SOCK_CLOEXEC). With reuseport set several sockets could be bound to the same port, kernel distributes incoming
+ * connections between them
+ */
+int make_listen_socket(uint16_t port, bool reuseport, int flags = SOCK_NONBLOCK);
+
+/**
+ * Makes kernel poll device queue for that many microseconds on blocking reads from the socket, returns false
+ * if it is not allowed
+ */
+bool set_socket_busy_poll(int sfd, int usec);
+
 } // namespace MTnonblock
 } // namespace Network
 } // namespace Afina
@@ -1,61 +1,154 @@
 #include "Worker.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <stdexcept>
 
 #include <netdb.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <spdlog/logger.h>
 
+#include <afina/execute/Stats.h>
 #include <afina/logging/Service.h>
+#include <afina/network/Config.h>
 
 #include "Connection.h"
+#include "ServerImpl.h"
 #include "Utils.h"
 
 namespace Afina {
 namespace Network {
 namespace MTnonblock {
 
+// Load is measured and connections are moved at most once per period
+static const std::chrono::milliseconds BALANCE_PERIOD(100);
+
+// Number of wakeups per period below which worker doesn't bother others with its connections
+static const std::size_t BALANCE_MIN_LOAD = 64;
+
+// Inbox of the worker which is gone for good, nobody could hand connections off to it anymore
+static char closed_inbox_tag;
+static Connection *const CLOSED_INBOX = reinterpret_cast<Connection *>(&closed_inbox_tag);
+
+// Rounds in which worker left its listening sockets alone, see Admission.h
+static std::atomic<int64_t> &ShedAccepts() {
+    static std::atomic<int64_t> &counter = Execute::Stats::Counter("shed_accepts");
+    return counter;
+}
+
 // See Worker.h
-Worker::Worker(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Afina::Logging::Service> pl)
-    : _pStorage(ps), _pLogging(pl), isRunning(false), _epoll_fd(-1) {
-    // TODO: implementation here
+Worker::Worker(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Afina::Logging::Service> pl,
+               std::shared_ptr<Config> pc, std::atomic<std::size_t> *output_size)
+    : _pStorage(ps), _pLogging(pl), _pConfig(pc), _output_size(output_size), _idle(pc->reuseport ? pc->idle_timeout : 0),
+      _server(nullptr), isRunning(false), _epoll_fd(-1),
+      _peers(nullptr), _inbox(nullptr), _inbox_fd(-1), _load(0), _load_time(0), _period(0), _wakeups(0),
+      _admission(pc->admission_target, pc->admission_interval) {
+    // Only worker owning its connections is able to give them away
+    if (_pConfig->reuseport && _pConfig->balance) {
+        _inbox_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_inbox_fd == -1) {
+            throw std::runtime_error("Failed to create eventfd: " + std::string(strerror(errno)));
+        }
+    }
 }
 
 // See Worker.h
 Worker::~Worker() {
-    // TODO: implementation here
+    // Worker which has never run could have got connections handed off
+    Connection *pconn = _inbox.exchange(nullptr);
+    while (pconn != nullptr && pconn != CLOSED_INBOX) {
+        Connection *next = pconn->_next_migrated;
+        delete pconn;
+        pconn = next;
+    }
+
+    if (_inbox_fd >= 0) {
+        close(_inbox_fd);
+    }
 }
 
 // See Worker.h
-Worker::Worker(Worker &&other) { *this = std::move(other); }
+Worker::Worker(Worker &&other) : _idle(0), _admission(0, 0) { *this = std::move(other); }
 
 // See Worker.h
 Worker &Worker::operator=(Worker &&other) {
     _pStorage = std::move(other._pStorage);
     _pLogging = std::move(other._pLogging);
     _logger = std::move(other._logger);
+    _pConfig = std::move(other._pConfig);
+    _output_size = other._output_size;
     _thread = std::move(other._thread);
     _epoll_fd = other._epoll_fd;
+    _listen_sockets = std::move(other._listen_sockets);
+    _connections = std::move(other._connections);
+    _ready = std::move(other._ready);
+    _idle = other._idle;
+    _server = other._server;
+    _peers = other._peers;
+    _inbox = other._inbox.exchange(nullptr);
+    _inbox_fd = other._inbox_fd;
+    _load = other._load.load();
+    _load_time = other._load_time.load();
+    _period = other._period;
+    _period_start = other._period_start;
+    _wakeups = other._wakeups;
+    _spin_until = other._spin_until;
+    _admission = other._admission;
 
     other._epoll_fd = -1;
+    other._inbox_fd = -1;
     return *this;
 }
 
 // See Worker.h
-void Worker::Start(int epoll_fd) {
+void Worker::Start(int epoll_fd, std::vector<int> listen_sockets, std::vector<Worker> *peers) {
     if (isRunning.exchange(true) == false) {
         assert(_epoll_fd == -1);
         _epoll_fd = epoll_fd;
+        _listen_sockets = std::move(listen_sockets);
         _logger = _pLogging->select("network.worker");
+
+        // Worker itself stands for all of its listen sockets, some of them could be shared by workers
+        for (int fd : _listen_sockets) {
+            struct epoll_event event;
+            event.events = EPOLLIN | EPOLLEXCLUSIVE;
+            event.data.ptr = this;
+            if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+                throw std::runtime_error("Failed to add file descriptor to epoll");
+            }
+        }
+
+        if (_inbox_fd >= 0 && peers != nullptr) {
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = &_inbox;
+            if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _inbox_fd, &event)) {
+                throw std::runtime_error("Failed to add file descriptor to epoll");
+            }
+            _peers = peers;
+            _period_start = std::chrono::steady_clock::now();
+        }
+
         _thread = std::thread(&Worker::OnRun, this);
     }
 }
 
+// See Worker.h
+void Worker::Start(int epoll_fd, ServerImpl *server) {
+    _server = server;
+    Start(epoll_fd);
+}
+
 // See Worker.h
 void Worker::Stop() { isRunning = false; }
 
@@ -74,24 +167,78 @@ void Worker::OnRun() {
     //
     // Do not forget to use EPOLLEXCLUSIVE flag when register socket
     // for events to avoid thundering herd type behavior.
-    int timeout = -1;
     std::array<struct epoll_event, 64> mod_list;
-    while (isRunning) {
+    std::vector<TimerWheel::Entry *> expired;
+    std::chrono::microseconds busy_poll(_pConfig->busy_poll);
+    bool stopping = false;
+    bool drained = false;
+    while (!drained) {
+        // Connections of shared epoll are drained by server, see Stop()
+        if (!isRunning && !stopping && !_listen_sockets.empty()) {
+            stopping = true;
+            OnStop();
+        }
+        if (stopping && _connections.empty()) {
+            // Peers could have handed connections off meanwhile, once inbox is closed nobody is able to do that
+            Connection *pconn = _inbox.exchange(CLOSED_INBOX, std::memory_order_acquire);
+            if (pconn == nullptr) {
+                break;
+            }
+            Adopt(pconn);
+            continue;
+        }
+
+        // Do not sleep while there are connections with unread data, nor past the moment idle ones must be closed.
+        // In busy poll mode don't sleep for a while after traffic either, next request is likely to come soon
+        int timeout = _ready.empty() ? _idle.Timeout() : 0;
+        if (busy_poll.count() > 0 && std::chrono::steady_clock::now() < _spin_until) {
+            timeout = 0;
+        }
         int nmod = epoll_wait(_epoll_fd, &mod_list[0], mod_list.size(), timeout);
+        if (busy_poll.count() > 0 && nmod > 0) {
+            _spin_until = std::chrono::steady_clock::now() + busy_poll;
+        } else if (nmod == 0 && timeout == 0) {
+            // Spinning worker must not starve threads it shares core with, clients in particular
+            std::this_thread::yield();
+        }
+        _idle.Update();
         _logger->debug("Worker wokeup: {} events", nmod);
 
+        // Connections of the shed round get busy error for whatever they ask, new ones wait in listen queue
+        auto round_start = std::chrono::steady_clock::now();
+        bool shed = _admission.Enabled() && _admission.Shed(round_start);
+
         for (int i = 0; i < nmod; i++) {
             struct epoll_event &current_event = mod_list[i];
 
             // nullptr is used by server for event_fd "interface", if we got here then server
             // signals us to wakeup to process some state change, ignore it in INNER loop, react
-            // on changes in OUTHER loop
+            // on changes in OUTHER loop. Shared epoll gets it only once there are no connections left
             if (current_event.data.ptr == nullptr) {
+                drained = _listen_sockets.empty();
+                continue;
+            }
+
+            // Worker itself stands for listen sockets
+            if (current_event.data.ptr == this) {
+                if (shed) {
+                    ShedAccepts().fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    OnNewConnection();
+                }
+                continue;
+            }
+
+            // Other worker has handed off some connections
+            if (current_event.data.ptr == &_inbox) {
+                OnMigrated();
                 continue;
             }
 
             // Some connection gets new data
             Connection *pconn = static_cast<Connection *>(current_event.data.ptr);
+            uint32_t prev_events = pconn->_event.events;
+            pconn->_shed = shed;
             if ((current_event.events & EPOLLERR) || (current_event.events & EPOLLHUP)) {
                 _logger->debug("Got EPOLLERR or EPOLLHUP, value of returned events: {}", current_event.events);
                 pconn->OnError();
@@ -109,30 +256,314 @@ void Worker::OnRun() {
                     pconn->DoWrite();
                 }
             }
+            OnProcessed(pconn, prev_events);
+        }
 
-            // Rearm connection
-            if (pconn->isAlive()) {
-                pconn->_event.events |= EPOLLONESHOT;
-                int epoll_ctl_retval;
-                if ((epoll_ctl_retval = epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, pconn->_socket, &pconn->_event))) {
-                    _logger->debug("epoll_ctl failed during connection rearm: error {}", epoll_ctl_retval);
-                    pconn->OnError();
-                    delete pconn;
-                }
+        // Connections stopped by read budget continue once everybody else got its turn
+        std::vector<Connection *> ready;
+        ready.swap(_ready);
+        for (Connection *pconn : ready) {
+            if (pconn == nullptr) {
+                continue;
             }
-            // Or delete closed one
-            else {
-                if (epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, pconn->_socket, &pconn->_event)) {
-                    std::cerr << "Failed to delete connection!" << std::endl;
-                }
+            pconn->_in_ready = false;
+            if (!pconn->isAlive()) {
                 delete pconn;
+                continue;
+            } else if (!pconn->isReady()) {
+                continue;
             }
+
+            uint32_t prev_events = pconn->_event.events;
+            pconn->_shed = shed;
+            pconn->DoRead();
+            OnProcessed(pconn, prev_events);
+        }
+
+        // Connection served last in the round has waited for about as long as the round took
+        if (_admission.Enabled()) {
+            auto now = std::chrono::steady_clock::now();
+            _admission.Observe(now - round_start, now, shed);
         }
-        // TODO: Select timeout...
+
+        _idle.Expire(expired);
+        for (TimerWheel::Entry *entry : expired) {
+            Connection *pconn = static_cast<Connection *>(entry->owner);
+            uint32_t prev_events = pconn->_event.events;
+            pconn->OnTimeout();
+            OnProcessed(pconn, prev_events);
+        }
+        expired.clear();
+
+        if (_peers != nullptr && !stopping && isRunning) {
+            Balance();
+        }
+    }
+
+    // Connections in private epoll belong to nobody else. Closed ones could still wait in ready list
+    for (Connection *pconn : _ready) {
+        if (pconn != nullptr && !pconn->isAlive()) {
+            delete pconn;
+        }
+    }
+    for (Connection *pconn : _connections) {
+        delete pconn;
     }
+    _connections.clear();
+    _ready.clear();
     _logger->warn("Worker stopped");
 }
 
+// See Worker.h
+void Worker::OnStop() {
+    _logger->debug("Stop worker, {} connections left", _connections.size());
+
+    // Listening sockets stay open, connections waiting in their queues are left for the next instance if any
+    for (int fd : _listen_sockets) {
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr)) {
+            _logger->error("Failed to delete listen socket from epoll: {}", strerror(errno));
+        }
+    }
+
+    // Commands which have already arrived are still read, then connection sees end of stream and gets closed
+    // once all responses are sent
+    for (Connection *pconn : _connections) {
+        shutdown(pconn->_socket, SHUT_RD);
+    }
+}
+
+// See Worker.h
+void Worker::OnProcessed(Connection *pconn, uint32_t prev_events) {
+    if (pconn->_period != _period) {
+        pconn->_period = _period;
+        pconn->_wakeups = 0;
+    }
+    pconn->_wakeups++;
+    _wakeups++;
+
+    // Rearm connection, private epoll keeps interest until it gets changed
+    if (pconn->isAlive()) {
+        // Once rearmed, connection could be closed by other worker, so activity is recorded first
+        if (_server != nullptr) {
+            _server->Touch(pconn);
+        } else {
+            _idle.Touch(&pconn->_wheel);
+        }
+
+        int epoll_ctl_retval = 0;
+        if (_listen_sockets.empty()) {
+            // Rearm reports data left in socket once again, so there is no need to track ready connections
+            pconn->_event.events |= EPOLLONESHOT;
+            epoll_ctl_retval = epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, pconn->_socket, &pconn->_event);
+        } else if (pconn->_event.events != prev_events) {
+            epoll_ctl_retval = epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, pconn->_socket, &pconn->_event);
+        }
+
+        if (epoll_ctl_retval == 0) {
+            // Connection which is already waiting for its turn could get here by epoll event
+            if (!_listen_sockets.empty() && pconn->isReady() && !pconn->_in_ready) {
+                pconn->_in_ready = true;
+                _ready.push_back(pconn);
+            }
+            return;
+        }
+
+        _logger->debug("epoll_ctl failed during connection rearm: error {}", epoll_ctl_retval);
+        pconn->OnError();
+    }
+    // Or delete closed one
+    else if (epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, pconn->_socket, &pconn->_event)) {
+        std::cerr << "Failed to delete connection!" << std::endl;
+    }
+
+    // Connection could be closed while waiting for its turn in ready list, then it is released from there
+    if (!_listen_sockets.empty()) {
+        _connections.erase(pconn);
+        _idle.Remove(&pconn->_wheel);
+    } else if (_server != nullptr) {
+        _server->Release(pconn);
+    }
+    if (!pconn->_in_ready) {
+        delete pconn;
+    }
+}
+
+// See Worker.h
+void Worker::OnNewConnection() {
+    // Event doesn't tell which socket is ready, but there are at most two of them
+    for (std::size_t i = 0; i < _listen_sockets.size();) {
+        struct sockaddr_storage in_addr;
+        socklen_t in_len = sizeof(in_addr);
+        int infd = accept4(_listen_sockets[i], (struct sockaddr *)&in_addr, &in_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (infd == -1) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                _logger->error("Failed to accept socket: {}", strerror(errno));
+            }
+            i++;
+            continue;
+        }
+
+        if (_logger->should_log(spdlog::level::debug)) {
+            char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
+            if (getnameinfo((struct sockaddr *)&in_addr, in_len, hbuf, sizeof hbuf, sbuf, sizeof sbuf,
+                            NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+                _logger->debug("Accepted connection on descriptor {} (host={}, port={})\n", infd, hbuf, sbuf);
+            }
+        }
+
+        if (_pConfig->socket_busy_poll > 0 && !set_socket_busy_poll(infd, _pConfig->socket_busy_poll)) {
+            _logger->debug("Failed to set busy poll on descriptor {}: {}", infd, strerror(errno));
+        }
+
+        Connection *pc = new Connection(infd, _pStorage, _logger, *_pConfig, _output_size);
+        pc->Start();
+        if (!pc->isAlive()) {
+            delete pc;
+            continue;
+        }
+
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, pc->_socket, &pc->_event)) {
+            _logger->debug("epoll_ctl failed during connection register: {}", strerror(errno));
+            pc->OnError();
+            delete pc;
+            continue;
+        }
+        _connections.insert(pc);
+        _idle.Add(&pc->_wheel);
+    }
+}
+
+// See Worker.h
+void Worker::OnMigrated() {
+    // Consume notification first: connections pushed after inbox is taken will signal once again
+    eventfd_t value;
+    eventfd_read(_inbox_fd, &value);
+
+    // Closed inbox stays closed
+    Connection *pconn = _inbox.load(std::memory_order_relaxed);
+    do {
+        if (pconn == CLOSED_INBOX) {
+            return;
+        }
+    } while (!_inbox.compare_exchange_weak(pconn, nullptr, std::memory_order_acquire, std::memory_order_relaxed));
+    Adopt(pconn);
+}
+
+// See Worker.h
+void Worker::Adopt(Connection *pconn) {
+    while (pconn != nullptr) {
+        Connection *next = pconn->_next_migrated;
+        pconn->_next_migrated = nullptr;
+
+        // Connection is reported by epoll right away if socket got ready while it was moving
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, pconn->_socket, &pconn->_event)) {
+            _logger->debug("epoll_ctl failed during migrated connection register: {}", strerror(errno));
+            pconn->OnError();
+            delete pconn;
+        } else {
+            _logger->debug("Got connection on descriptor {} from other worker", pconn->_socket);
+            _connections.insert(pconn);
+            _idle.Add(&pconn->_wheel);
+            if (!isRunning) {
+                shutdown(pconn->_socket, SHUT_RD);
+            }
+            if (pconn->isReady()) {
+                pconn->_in_ready = true;
+                _ready.push_back(pconn);
+            }
+        }
+        pconn = next;
+    }
+}
+
+// See Worker.h
+void Worker::Balance() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - _period_start < BALANCE_PERIOD) {
+        return;
+    }
+
+    std::size_t load = _wakeups;
+    _load.store(load, std::memory_order_relaxed);
+    _load_time.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+
+    Worker *target = nullptr;
+    std::size_t target_load = 0;
+    for (Worker &w : *_peers) {
+        // Stopped worker reports no load, but it is the last one to take connections
+        std::size_t l = w.Load();
+        if (&w != this && w.isRunning && (target == nullptr || l < target_load)) {
+            target = &w;
+            target_load = l;
+        }
+    }
+
+    // Small skew isn't worth moving connections around
+    if (target != nullptr && load >= BALANCE_MIN_LOAD && load > 2 * target_load && _connections.size() > 1) {
+        // Pick the heaviest connection which doesn't make target more loaded than this worker
+        std::size_t surplus = (load - target_load) / 2;
+        Connection *candidate = nullptr;
+        for (Connection *pconn : _connections) {
+            if (pconn->_period == _period && pconn->_wakeups <= surplus &&
+                (candidate == nullptr || pconn->_wakeups > candidate->_wakeups)) {
+                candidate = pconn;
+            }
+        }
+
+        if (candidate != nullptr) {
+            Migrate(candidate, *target);
+        }
+    }
+
+    _period++;
+    _period_start = now;
+    _wakeups = 0;
+}
+
+// See Worker.h
+void Worker::Migrate(Connection *pconn, Worker &target) {
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, pconn->_socket, &pconn->_event)) {
+        _logger->debug("epoll_ctl failed during connection migration: {}", strerror(errno));
+        return;
+    }
+    _connections.erase(pconn);
+    _idle.Remove(&pconn->_wheel);
+
+    // New owner must not find connection in the list, that happens at most once per balancing period
+    if (pconn->_in_ready) {
+        pconn->_in_ready = false;
+        std::replace(_ready.begin(), _ready.end(), pconn, static_cast<Connection *>(nullptr));
+    }
+    _logger->debug("Move connection on descriptor {} to other worker", pconn->_socket);
+
+    // Release pairs with acquire in OnMigrated, so new owner sees connection state as it is left here
+    Connection *head = target._inbox.load(std::memory_order_relaxed);
+    do {
+        // Target has been stopped and is gone already, connection stays here
+        if (head == CLOSED_INBOX) {
+            _logger->debug("Worker is gone, keep connection on descriptor {}", pconn->_socket);
+            Adopt(pconn);
+            return;
+        }
+        pconn->_next_migrated = head;
+    } while (!target._inbox.compare_exchange_weak(head, pconn, std::memory_order_release, std::memory_order_relaxed));
+
+    if (eventfd_write(target._inbox_fd, 1)) {
+        _logger->error("Failed to wakeup worker: {}", strerror(errno));
+    }
+}
+
+// See Worker.h
+std::size_t Worker::Load() const {
+    // Worker sleeping in epoll_wait doesn't update its load, but obviously has nothing to do
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto stale = std::chrono::duration_cast<std::chrono::steady_clock::duration>(2 * BALANCE_PERIOD).count();
+    if (now - _load_time.load(std::memory_order_relaxed) > stale) {
+        return 0;
+    }
+    return _load.load(std::memory_order_relaxed);
+}
+
 } // namespace MTnonblock
 } // namespace Network
 } // namespace Afina
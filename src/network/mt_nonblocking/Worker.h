@@ -2,8 +2,14 @@
 #define AFINA_NETWORK_MT_NONBLOCKING_WORKER_H
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "network/Admission.h"
+#include "network/TimerWheel.h"
 
 namespace spdlog {
 class logger;
@@ -18,16 +24,32 @@ class Service;
 }
 
 namespace Network {
+
+// Forward declaration, see afina/network/Config.h
+class Config;
+
 namespace MTnonblock {
 
+// Forward declarations, see Connection.h and ServerImpl.h
+class Connection;
+class ServerImpl;
+
 /**
  * # Thread running epoll
  * On Start spaws background thread that is doing epoll on the given server
  * socket and process incoming connections and its data
+ *
+ * Worker owning its connections (private epoll) could hand some of them off to other workers once it is
+ * loaded much more than they are, see Config::balance. Connection is removed from epoll of the current
+ * owner, pushed into lock free inbox of the new one and the latter gets notified through eventfd
+ *
+ * Every epoll wakeup is a round of serving ready connections, its duration is the queueing delay worker
+ * reports for admission control, see Config::admission_target
  */
 class Worker {
 public:
-    Worker(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Afina::Logging::Service> pl);
+    Worker(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Afina::Logging::Service> pl,
+           std::shared_ptr<Config> pc, std::atomic<std::size_t> *output_size);
     ~Worker();
 
     Worker(Worker &&);
@@ -37,14 +59,30 @@ public:
      * Spaws new background thread that is doing epoll on the given server
      * socket. Once connection accepted it must be registered and being processed
      * on this thread
+     *
+     * If listen sockets are given, then epoll instance is private to the worker: it accepts connections
+     * on its own and keeps them until close. Otherwise epoll is shared with other workers and connections
+     * are registered by acceptors with EPOLLONESHOT. Listen socket could be shared with other workers too,
+     * kernel wakes up only one of them per connection
+     *
+     * Peers are workers connections could be moved to, must outlive this one
+     */
+    void Start(int epoll_fd, std::vector<int> listen_sockets = {}, std::vector<Worker> *peers = nullptr);
+
+    /**
+     * Same as above for epoll shared with other workers. Connections are owned by the given server, worker
+     * records their activity there and releases ones it closes
      */
-    void Start(int epoll_fd);
+    void Start(int epoll_fd, ServerImpl *server);
 
     /**
      * Signal background thread to stop. After that signal thread must stop to
      * accept new connections and must stop read new commands from existing. Once
      * all readed commands are executed and results are send back to client, thread
      * must stop
+     *
+     * Worker of shared epoll leaves that to server: it exits once server wakes it up through eventfd, which
+     * happens after all connections are gone
      */
     void Stop();
 
@@ -60,6 +98,46 @@ protected:
      */
     void OnRun();
 
+    /**
+     * Accept all pending connections on listen sockets
+     */
+    void OnNewConnection();
+
+    /**
+     * Stop accepting connections and let owned ones finish commands they have already sent
+     */
+    void OnStop();
+
+    /**
+     * Register connection events once it is done with current wakeup, release it if connection is closed
+     */
+    void OnProcessed(Connection *pconn, uint32_t prev_events);
+
+    /**
+     * Register connections handed off by other workers
+     */
+    void OnMigrated();
+
+    /**
+     * Register connections linked through Connection::_next_migrated as owned by this worker
+     */
+    void Adopt(Connection *pconn);
+
+    /**
+     * Publish load of the last period and move connection to other worker if load is skewed
+     */
+    void Balance();
+
+    /**
+     * Hand off connection to the given worker, connection stays with this one if target is gone already
+     */
+    void Migrate(Connection *pconn, Worker &target);
+
+    /**
+     * Number of connection wakeups served by worker during last balancing period
+     */
+    std::size_t Load() const;
+
 private:
     Worker(Worker &) = delete;
     Worker &operator=(Worker &) = delete;
@@ -73,6 +151,18 @@ private:
     // Logger to be used
     std::shared_ptr<spdlog::logger> _logger;
 
+    // Network settings
+    std::shared_ptr<Config> _pConfig;
+
+    // Total size of responses in all connections of the server
+    std::atomic<std::size_t> *_output_size;
+
+    // Connections to be closed once idle for too long, used only if epoll is private
+    TimerWheel _idle;
+
+    // Server owning connections, used only if epoll is shared
+    ServerImpl *_server;
+
     // Flag signals that thread should continue to operate
     std::atomic<bool> isRunning;
 
@@ -81,6 +171,43 @@ private:
 
     // EPOLL descriptor using for events processing
     int _epoll_fd;
+
+    // Sockets to accept connections on, empty if epoll is shared between workers
+    std::vector<int> _listen_sockets;
+
+    // Connections owned by this worker, tracked only if epoll is private
+    std::unordered_set<Connection *> _connections;
+
+    // Connections which have exhausted read budget and must be served again without waiting for epoll,
+    // used only if epoll is private. Every connection is listed at most once, see Connection::_in_ready.
+    // Entries aren't removed when connection drains its socket or gets closed, they are skipped once list
+    // is served; moved connection leaves null entry behind
+    std::vector<Connection *> _ready;
+
+    // Workers connections could be moved to, nullptr if balancing is off
+    std::vector<Worker> *_peers;
+
+    // Connections handed off by other workers, linked through Connection::_next_migrated. Worker closes its
+    // inbox once it has stopped and is about to leave, taking whatever is left there
+    std::atomic<Connection *> _inbox;
+
+    // Signals that there is something in inbox
+    int _inbox_fd;
+
+    // Load published for other workers and time it was measured at, see Load()
+    std::atomic<std::size_t> _load;
+    std::atomic<std::chrono::steady_clock::rep> _load_time;
+
+    // Current balancing period and number of connection wakeups since its start
+    unsigned _period;
+    std::chrono::steady_clock::time_point _period_start;
+    std::size_t _wakeups;
+
+    // Worker polls epoll without sleeping until that moment, see Config::busy_poll
+    std::chrono::steady_clock::time_point _spin_until;
+
+    // Decides which rounds are shed once worker gets overloaded
+    Admission _admission;
 };
 
 } // namespace MTnonblock
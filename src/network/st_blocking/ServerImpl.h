@@ -20,7 +20,7 @@ namespace STblocking {
  */
 class ServerImpl : public Server {
 public:
-    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl);
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl, std::shared_ptr<Config> pc);
     ~ServerImpl();
 
     // See Server.h
@@ -50,6 +50,9 @@ private:
     // Server socket to accept connections on
     int _server_socket;
 
+    // Unix domain socket to accept connections from the same host on, -1 if there is none
+    int _unix_socket;
+
     // Thread to run network on
     std::thread _thread;
 };
@@ -0,0 +1,117 @@
+#include "Connection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/Storage.h>
+#include <afina/coroutine/Engine.h>
+
+namespace Afina {
+namespace Network {
+namespace STcoroutine {
+
+// See Connection.h
+Connection::~Connection() { close(_socket); }
+
+// See Connection.h
+void Connection::Run() {
+    _logger->debug("Start connection on descriptor {}", _socket);
+    for (;;) {
+        ssize_t bytes = Read();
+        if (bytes == 0) {
+            _logger->debug("Connection on descriptor {} closed by client", _socket);
+            break;
+        } else if (bytes < 0) {
+            _logger->debug("Connection on descriptor {} failed", _socket);
+            break;
+        }
+
+        _read_bytes += bytes;
+        _logger->debug("Got {} bytes from socket {}", bytes, _socket);
+        Process();
+
+        if (!Write()) {
+            _logger->debug("Connection on descriptor {} failed", _socket);
+            break;
+        }
+    }
+}
+
+// See Connection.h
+ssize_t Connection::Read() {
+    for (;;) {
+        ssize_t bytes = read(_socket, _read_buffer + _read_bytes, sizeof(_read_buffer) - _read_bytes);
+        if (bytes >= 0) {
+            return bytes;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            _engine.block();
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+// See Connection.h
+bool Connection::Write() {
+    struct iovec iov[64];
+    while (!_output.Empty()) {
+        ssize_t sent = writev(_socket, iov, _output.Prepare(iov, 64));
+        if (sent >= 0) {
+            _output.Consume(sent);
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            _engine.block();
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// See Connection.h
+void Connection::Process() {
+    auto execute = [this](Execute::Command &command, std::string &args, Execute::Response &) {
+        Execute(command, args);
+    };
+    std::size_t consumed = _stream.Process(_read_buffer, _read_bytes, _output, execute);
+    std::memmove(_read_buffer, _read_buffer + consumed, _read_bytes - consumed);
+    _read_bytes -= consumed;
+}
+
+// See Connection.h
+void Connection::Execute(Execute::Command &command, std::string &args) {
+    if (_offload == nullptr || !_offload->Heavy(command, args.size())) {
+        command.Execute(*_pStorage, args, _output);
+        return;
+    }
+
+    Offload::Job *job = new Offload::Job();
+    job->command = command;
+    job->args.swap(args);
+    job->owner = this;
+
+    // Pool has no room for the job only if it is overloaded already, then command is executed here
+    if (!_offload->Submit(job)) {
+        command.Execute(*_pStorage, job->args, _output);
+        delete job;
+        return;
+    }
+
+    // Socket events unblock coroutine as well, so wait until it is the job
+    _job = job;
+    while (_job != nullptr) {
+        _engine.block();
+    }
+    _output.Splice(job->out);
+    delete job;
+}
+
+} // namespace STcoroutine
+} // namespace Network
+} // namespace Afina
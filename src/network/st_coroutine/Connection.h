@@ -0,0 +1,117 @@
+#ifndef AFINA_NETWORK_ST_COROUTINE_CONNECTION_H
+#define AFINA_NETWORK_ST_COROUTINE_CONNECTION_H
+
+#include <memory>
+#include <string>
+
+#include <sys/types.h>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include "network/CommandStream.h"
+#include "network/Offload.h"
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Coroutine {
+class Engine;
+}
+
+namespace Network {
+namespace STcoroutine {
+
+/**
+ * # Client connection served by coroutine
+ * Connection code is written as if sockets were blocking: read a chunk, execute commands in it, send all
+ * responses and go on. Once socket has nothing to read or no room to write, coroutine gets blocked and
+ * the rest of connections are served meanwhile. Server unblocks it as soon as epoll reports the socket.
+ *
+ * Responses are sent before the next chunk is read, so connection never holds more than a single chunk
+ * worth of them and client which doesn't read responses just stops being read from.
+ *
+ * Heavy command is handed over to Offload pool and coroutine gets blocked until server reports it is done,
+ * so other connections are served meanwhile while this one keeps its commands in order
+ *
+ * Coroutines share the same stack memory, which gets copied on every switch, so all the state lives here
+ * rather than in coroutine frames
+ */
+class Connection {
+public:
+    Connection(int s, std::shared_ptr<Afina::Storage> ps, std::shared_ptr<spdlog::logger> pl,
+               Coroutine::Engine &engine, Offload *offload = nullptr)
+        : _socket(s), _pStorage(std::move(ps)), _logger(std::move(pl)), _engine(engine), _routine(nullptr),
+          _offload(offload), _job(nullptr), _read_bytes(0), _stream(*_pStorage) {}
+
+    ~Connection();
+
+    /**
+     * Serve connection until client closes it or it fails, body of the connection coroutine
+     */
+    void Run();
+
+private:
+    friend class ServerImpl;
+
+    // Size of the chunk read from the socket at once
+    static const size_t READ_BUFFER_SIZE = 4096;
+
+    /**
+     * Read available data into the buffer, blocks coroutine until there is some. Returns 0 once client
+     * has closed its side, -1 on error
+     */
+    ssize_t Read();
+
+    /**
+     * Send all pending responses, blocks coroutine while socket has no room for them. Returns false on error
+     */
+    bool Write();
+
+    /**
+     * Execute all complete commands in the read buffer
+     */
+    void Process();
+
+    /**
+     * Execute command either right here or by Offload pool, blocking coroutine until it is done
+     */
+    void Execute(Execute::Command &command, std::string &args);
+
+    int _socket;
+
+    // afina services
+    std::shared_ptr<Afina::Storage> _pStorage;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Coroutine serving connection
+    Coroutine::Engine &_engine;
+    void *_routine;
+
+    // Pool to execute heavy commands in, nullptr if they are executed inline, and the command being executed.
+    // Server resets job once it is done
+    Offload *_offload;
+    Offload::Job *_job;
+
+    // Bytes read from the socket but not processed yet
+    char _read_buffer[READ_BUFFER_SIZE];
+    std::size_t _read_bytes;
+
+    // Parse state of the stream
+    CommandStream _stream;
+
+    // Responses waiting to be sent
+    Execute::Response _output;
+};
+
+} // namespace STcoroutine
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_ST_COROUTINE_CONNECTION_H
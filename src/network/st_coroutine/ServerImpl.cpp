@@ -0,0 +1,277 @@
+#include "ServerImpl.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <netdb.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/Storage.h>
+#include <afina/logging/Service.h>
+
+#include "Connection.h"
+#include "Utils.h"
+#include "network/Offload.h"
+#include "network/Unix.h"
+
+namespace Afina {
+namespace Network {
+namespace STcoroutine {
+
+// See Server.h
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl,
+                       std::shared_ptr<Config> pc)
+    : Server(ps, pl, pc), _server_socket(-1), _unix_socket(-1), _event_fd(-1), _epoll_fd(-1), _engine([this] { OnIdle(); }),
+      _acceptor(nullptr), _stopping(false) {}
+
+// See Server.h
+ServerImpl::~ServerImpl() {}
+
+// See Server.h
+void ServerImpl::Start(uint16_t port, uint32_t n_acceptors, uint32_t n_workers) {
+    _logger = pLogging->select("network");
+    _logger->info("Start st_coroutine network service");
+
+    sigset_t sig_mask;
+    sigemptyset(&sig_mask);
+    sigaddset(&sig_mask, SIGPIPE);
+    if (pthread_sigmask(SIG_BLOCK, &sig_mask, NULL) != 0) {
+        throw std::runtime_error("Unable to mask SIGPIPE");
+    }
+
+    // Socket handed over by the previous instance is already bound and listening
+    _server_socket = -1;
+    if (!pConfig->unix_only) {
+        _server_socket = pConfig->TakeListenSocket(AF_INET);
+        if (_server_socket >= 0) {
+            _logger->warn("Use inherited listening socket {}", _server_socket);
+            make_socket_non_blocking(_server_socket);
+        } else {
+            _server_socket = make_listen_socket(port);
+        }
+    }
+
+    _unix_socket = -1;
+    if (!pConfig->unix_socket.empty()) {
+        _unix_socket = pConfig->TakeListenSocket(AF_UNIX);
+        if (_unix_socket >= 0) {
+            _logger->warn("Use inherited unix listening socket {}", _unix_socket);
+            make_socket_non_blocking(_unix_socket);
+        } else {
+            _unix_socket = make_unix_listen_socket(pConfig->unix_socket, SOCK_NONBLOCK);
+        }
+    }
+
+    _event_fd = eventfd(0, EFD_NONBLOCK);
+    if (_event_fd == -1) {
+        throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
+    }
+
+    _epoll_fd = epoll_create1(0);
+    if (_epoll_fd == -1) {
+        throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _event_fd, &event)) {
+        throw std::runtime_error("Failed to add file descriptor to epoll");
+    }
+
+    if (pConfig->offload_threads > 0) {
+        _offload.reset(new Offload(pStorage, *pConfig));
+        event.events = EPOLLIN;
+        event.data.ptr = _offload.get();
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _offload->EventFd(), &event)) {
+            throw std::runtime_error("Failed to add file descriptor to epoll");
+        }
+    }
+
+    // Acceptor is unblocked by any of listening sockets
+    for (int fd : ListenSockets()) {
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = this;
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+            throw std::runtime_error("Failed to add file descriptor to epoll");
+        }
+    }
+
+    _stopping = false;
+    _work_thread = std::thread(&ServerImpl::OnRun, this);
+}
+
+// See Server.h
+void ServerImpl::Stop() {
+    _logger->warn("Stop network service");
+
+    // Wakeup thread that is sleep on epoll_wait
+    if (eventfd_write(_event_fd, 1)) {
+        throw std::runtime_error("Failed to wakeup workers");
+    }
+}
+
+// See Server.h
+void ServerImpl::Join() {
+    // Wait for work to be complete
+    _work_thread.join();
+    close(_epoll_fd);
+    close(_server_socket);
+    close(_unix_socket);
+    close(_event_fd);
+    _offload.reset();
+}
+
+// See Server.h
+std::vector<int> ServerImpl::ListenSockets() const {
+    std::vector<int> result;
+    for (int fd : {_server_socket, _unix_socket}) {
+        if (fd >= 0) {
+            result.push_back(fd);
+        }
+    }
+    return result;
+}
+
+// See ServerImpl.h
+void ServerImpl::OnRun() {
+    _logger->info("Start acceptor");
+
+    // Engine returns once all coroutines are done, which happens only after stop
+    _engine.start(&ServerImpl::Main, this);
+    _logger->warn("Acceptor stopped");
+}
+
+// See ServerImpl.h
+void ServerImpl::OnIdle() {
+    std::array<struct epoll_event, 64> mod_list;
+    int nmod = epoll_wait(_epoll_fd, &mod_list[0], mod_list.size(), -1);
+    if (nmod == -1 && errno != EINTR) {
+        // Runs on some coroutine stack, so there is nobody to catch an exception
+        _logger->error("Failed to wait for events: {}", strerror(errno));
+    }
+
+    for (int i = 0; i < nmod; i++) {
+        void *ptr = mod_list[i].data.ptr;
+        if (ptr == nullptr) {
+            OnStop();
+        } else if (ptr == this) {
+            _engine.unblock(_acceptor);
+        } else if (_offload && ptr == _offload.get()) {
+            std::vector<Offload::Job *> jobs;
+            _offload->Done(jobs);
+            for (Offload::Job *job : jobs) {
+                Connection *pc = static_cast<Connection *>(job->owner);
+                pc->_job = nullptr;
+                _engine.unblock(pc->_routine);
+            }
+        } else {
+            _engine.unblock(static_cast<Connection *>(ptr)->_routine);
+        }
+    }
+}
+
+// See ServerImpl.h
+void ServerImpl::OnStop() {
+    _logger->debug("Stop acceptor, {} connections left", _connections.size());
+    _stopping = true;
+
+    // Listening sockets stay open, connections waiting in their queues are left for the next instance if any
+    for (int fd : ListenSockets()) {
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr)) {
+            _logger->error("Failed to delete file descriptor from epoll");
+        }
+    }
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, _event_fd, nullptr)) {
+        _logger->error("Failed to delete file descriptor from epoll");
+    }
+    _engine.unblock(_acceptor);
+
+    // Commands which have already arrived are still read, then connection sees end of stream and its
+    // coroutine is done once all responses are sent
+    for (Connection *pc : _connections) {
+        shutdown(pc->_socket, SHUT_RD);
+    }
+}
+
+// See ServerImpl.h
+void ServerImpl::OnAccept() {
+    // Sockets are edge triggered, so acceptor blocks only once both of them are drained
+    std::vector<int> sockets = ListenSockets();
+    std::size_t drained = 0;
+    for (std::size_t i = 0; !_stopping; i = (i + 1) % sockets.size()) {
+        struct sockaddr_storage in_addr;
+        socklen_t in_len = sizeof(in_addr);
+        int infd = accept4(sockets[i], (struct sockaddr *)&in_addr, &in_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (infd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                _logger->error("Failed to accept socket: {}", strerror(errno));
+            }
+            if (++drained == sockets.size()) {
+                drained = 0;
+                _engine.block();
+            }
+            continue;
+        }
+        drained = 0;
+
+        if (_logger->should_log(spdlog::level::debug)) {
+            char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
+            if (getnameinfo((struct sockaddr *)&in_addr, in_len, hbuf, sizeof hbuf, sbuf, sizeof sbuf,
+                            NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+                _logger->debug("Accepted connection on descriptor {} (host={}, port={})\n", infd, hbuf, sbuf);
+            }
+        }
+
+        Connection *pc = new Connection(infd, pStorage, _logger, _engine, _offload.get());
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        event.data.ptr = pc;
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, infd, &event)) {
+            _logger->error("Failed to add connection to epoll: {}", strerror(errno));
+            delete pc;
+            continue;
+        }
+
+        // Coroutine doesn't get control right away, accepting goes on until there is nothing left
+        pc->_routine = _engine.run(&ServerImpl::Serve, this, pc);
+        if (pc->_routine == nullptr) {
+            OnClose(pc);
+            continue;
+        }
+        _connections.insert(pc);
+    }
+}
+
+// See ServerImpl.h
+void ServerImpl::OnClose(Connection *pc) {
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, pc->_socket, nullptr)) {
+        _logger->error("Failed to delete connection from epoll");
+    }
+    _connections.erase(pc);
+    delete pc;
+}
+
+// See ServerImpl.h
+void ServerImpl::Main(ServerImpl *server) { server->_acceptor = server->_engine.run(&ServerImpl::Accept, server); }
+
+// See ServerImpl.h
+void ServerImpl::Accept(ServerImpl *server) { server->OnAccept(); }
+
+// See ServerImpl.h
+void ServerImpl::Serve(ServerImpl *server, Connection *pc) {
+    pc->Run();
+    server->OnClose(pc);
+}
+
+} // namespace STcoroutine
+} // namespace Network
+} // namespace Afina
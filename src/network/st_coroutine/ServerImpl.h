@@ -0,0 +1,119 @@
+#ifndef AFINA_NETWORK_ST_COROUTINE_SERVER_H
+#define AFINA_NETWORK_ST_COROUTINE_SERVER_H
+
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <afina/coroutine/Engine.h>
+#include <afina/network/Server.h>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Network {
+
+// Forward declaration, see network/Offload.h
+class Offload;
+
+namespace STcoroutine {
+
+// Forward declaration, see Connection.h
+class Connection;
+
+/**
+ * # Network resource manager implementation
+ * Single threaded server running coroutine per connection plus one accepting new connections. Coroutine
+ * waiting for socket is blocked in engine, once nobody is able to run engine asks server to wait for
+ * events in epoll and unblock coroutines whose sockets got ready.
+ *
+ * Sockets are registered in edge triggered mode for both reading and writing just once: coroutine gets
+ * blocked only after socket has reported EAGAIN, so any edge afterwards means it could go on
+ */
+class ServerImpl : public Server {
+public:
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl, std::shared_ptr<Config> pc);
+    ~ServerImpl();
+
+    // See Server.h
+    void Start(uint16_t port, uint32_t acceptors, uint32_t workers) override;
+
+    // See Server.h
+    void Stop() override;
+
+    // See Server.h
+    void Join() override;
+
+    // See Server.h
+    std::vector<int> ListenSockets() const override;
+
+protected:
+    void OnRun();
+
+    /**
+     * Wait for events and unblock coroutines which could go on, called by engine once nobody is able to run
+     */
+    void OnIdle();
+
+    /**
+     * Stop accepting connections and let existing ones finish commands they have already sent
+     */
+    void OnStop();
+
+    /**
+     * Body of the accepting coroutine
+     */
+    void OnAccept();
+
+    /**
+     * Release connection once its coroutine is done
+     */
+    void OnClose(Connection *pc);
+
+private:
+    // Coroutine entry points
+    static void Main(ServerImpl *server);
+    static void Accept(ServerImpl *server);
+    static void Serve(ServerImpl *server, Connection *pc);
+
+    // logger to use
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Socket to accept new connection on
+    int _server_socket;
+
+    // Unix domain socket to accept connections from the same host on, -1 if there is none
+    int _unix_socket;
+
+    // Curstom event "device" used to wakeup server
+    int _event_fd;
+
+    // Epoll instance all sockets are registered in
+    int _epoll_fd;
+
+    // IO thread
+    std::thread _work_thread;
+
+    // Coroutines runtime, used only by IO thread
+    Coroutine::Engine _engine;
+
+    // Coroutine accepting new connections
+    void *_acceptor;
+
+    // Pool executing heavy commands, null if everything is executed by IO thread
+    std::unique_ptr<Offload> _offload;
+
+    // Server has been asked to stop, coroutines are finishing
+    bool _stopping;
+
+    // All connections being served
+    std::unordered_set<Connection *> _connections;
+};
+
+} // namespace STcoroutine
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_ST_COROUTINE_SERVER_H
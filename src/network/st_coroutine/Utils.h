@@ -0,0 +1,21 @@
+#ifndef AFINA_NETWORK_ST_COROUTINE_UTILS_H
+#define AFINA_NETWORK_ST_COROUTINE_UTILS_H
+
+#include <cstdint>
+
+namespace Afina {
+namespace Network {
+namespace STcoroutine {
+
+void make_socket_non_blocking(int sfd);
+
+/**
+ * Creates non blocking socket listening for TCP connections on the given port
+ */
+int make_listen_socket(uint16_t port);
+
+} // namespace STcoroutine
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_ST_COROUTINE_UTILS_H
@@ -1,36 +1,168 @@
 #ifndef AFINA_NETWORK_ST_NONBLOCKING_CONNECTION_H
 #define AFINA_NETWORK_ST_NONBLOCKING_CONNECTION_H
 
+#include <atomic>
 #include <cstring>
+#include <memory>
+#include <string>
 
 #include <sys/epoll.h>
 
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+#include <afina/network/Config.h>
+
+#include "network/BufferPool.h"
+#include "network/CommandStream.h"
+#include "network/Offload.h"
+#include "network/TimerWheel.h"
+
+namespace spdlog {
+class logger;
+}
+
 namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
 namespace Network {
 namespace STnonblock {
 
+/**
+ * # Client connection state machine
+ * All connections are served by the single thread, so no locking is required. Once connection is done
+ * with an event server asks it for the events it is interested in: reading is wanted until client closes
+ * its side, writing only while there are pending responses.
+ *
+ * In edge triggered mode connection reads until socket is drained or read budget is exhausted. In the last
+ * case connection is marked as ready: there could be more data which epoll is not going to report again
+ *
+ * Connection stops executing and reading commands once its responses hit the high watermark, or there are
+ * too many responses not sent in all connections together, and resumes after client takes them. Same happens
+ * while its heavy command is executed by Offload pool, until server hands the result back
+ */
 class Connection {
 public:
-    Connection(int s) : _socket(s) {
+    Connection(int s, std::shared_ptr<Afina::Storage> ps, std::shared_ptr<spdlog::logger> pl, const Config &config,
+               std::atomic<std::size_t> *output_size, Offload *offload = nullptr)
+        : _socket(s), _pStorage(std::move(ps)), _logger(std::move(pl)), _edge_triggered(config.edge_triggered),
+          _read_budget(config.read_budget), _high_watermark(config.output_high_watermark),
+          _low_watermark(config.output_low_watermark), _output_limit(config.output_limit), _output_size(output_size),
+          _offload(offload), _job(nullptr), _alive(false), _eof(false), _ready(false), _in_ready(false),
+          _throttled(false), _stream(*_pStorage), _accounted(0), _wheel(this) {
         std::memset(&_event, 0, sizeof(struct epoll_event));
         _event.data.ptr = this;
     }
 
-    inline bool isAlive() const { return true; }
+    ~Connection();
+
+    inline bool isAlive() const { return _alive; }
+
+    // Connection has stopped reading because of budget, not because socket is drained
+    inline bool isReady() const { return _ready; }
 
     void Start();
 
 protected:
     void OnError();
     void OnClose();
+    void OnTimeout();
     void DoRead();
     void DoWrite();
 
+    /**
+     * Takes result of the heavy command back and goes on with the rest of commands
+     */
+    void OnOffloaded(Offload::Job *job);
+
 private:
     friend class ServerImpl;
 
+    /**
+     * Execute all complete commands in the read buffer
+     */
+    void Process();
+
+    /**
+     * Try to send pending responses without blocking, returns false if connection is broken
+     */
+    bool Flush();
+
+    /**
+     * Send pending responses and execute commands left in read buffer while they fit under output limits,
+     * returns false if connection is broken
+     */
+    bool Resume();
+
+    /**
+     * Recalculates events connection is interested in
+     */
+    void UpdateEvents();
+
+    /**
+     * Checks if connection must stop executing commands until responses are sent
+     */
+    bool Throttled();
+
+    /**
+     * Reflect changes in size of the output queue in total size of all connections
+     */
+    void Account();
+
     int _socket;
     struct epoll_event _event;
+
+    // afina services
+    std::shared_ptr<Afina::Storage> _pStorage;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Epoll mode, see Config.h
+    bool _edge_triggered;
+    std::size_t _read_budget;
+
+    // Output limits, see Config.h
+    std::size_t _high_watermark;
+    std::size_t _low_watermark;
+    std::size_t _output_limit;
+
+    // Total size of responses in all connections of the server
+    std::atomic<std::size_t> *_output_size;
+
+    // Pool to execute heavy commands in, nullptr if they are executed inline, and the command being executed
+    Offload *_offload;
+    Offload::Job *_job;
+
+    // Connection could be served further
+    bool _alive;
+
+    // Client has closed its side, connection gets closed once all responses are sent
+    bool _eof;
+
+    // There could be more data in socket to read
+    bool _ready;
+
+    // Connection has an entry in ready list of its owner. Closed connection is released only once owner
+    // gets to that entry
+    bool _in_ready;
+
+    // Output queue has hit high watermark and hasn't gone below low one yet
+    bool _throttled;
+
+    // Bytes read from the socket but not processed yet, holds pooled memory only while not empty
+    ReadBuffer _input;
+
+    // Parse state of the stream
+    CommandStream _stream;
+
+    // Responses waiting to be sent
+    Execute::Response _output;
+
+    // Part of _output_size contributed by this connection
+    std::size_t _accounted;
+
+    // Position in the idle connections timing wheel
+    TimerWheel::Entry _wheel;
 };
 
 } // namespace STnonblock
@@ -0,0 +1,278 @@
+#include "Fifo.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Network {
+namespace STnonblock {
+
+// Pipe capacity requested for responses, default one holds just 16 pages
+static const int WRITE_PIPE_SIZE = 1024 * 1024;
+
+// Opens FIFO at the given path, creates it if there is nothing there
+static int OpenFifo(const std::string &path, int flags) {
+    if (mkfifo(path.c_str(), 0600) == -1 && errno != EEXIST) {
+        throw std::runtime_error("Failed to create fifo " + path + ": " + std::string(strerror(errno)));
+    }
+
+    int fd = open(path.c_str(), flags | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open fifo " + path + ": " + std::string(strerror(errno)));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISFIFO(st.st_mode)) {
+        close(fd);
+        throw std::runtime_error("Not a fifo: " + path);
+    }
+    return fd;
+}
+
+// See Fifo.h
+Fifo::Fifo(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<spdlog::logger> pl, const Config &config)
+    : _pStorage(std::move(ps)), _logger(std::move(pl)), _read_path(config.read_fifo), _write_path(config.write_fifo),
+      _read_fd(-1), _write_fd(-1), _epoll_fd(-1), _read_budget(config.read_budget),
+      _high_watermark(config.output_high_watermark), _low_watermark(config.output_low_watermark), _stopped(false),
+      _throttled(false), _read_events(0), _read_bytes(0),
+      _stream(*_pStorage), _spliced(0), _pushed(0) {}
+
+// See Fifo.h
+Fifo::~Fifo() {
+    if (_read_fd >= 0) {
+        close(_read_fd);
+    }
+    if (_write_fd >= 0) {
+        close(_write_fd);
+    }
+}
+
+// See Fifo.h
+void Fifo::Open() {
+    _read_fd = OpenFifo(_read_path, O_RDONLY);
+    if (!_write_path.empty()) {
+        _write_fd = OpenFifo(_write_path, O_RDWR);
+        if (fcntl(_write_fd, F_SETPIPE_SZ, WRITE_PIPE_SIZE) == -1) {
+            _logger->warn("Failed to resize fifo {}: {}", _write_path, strerror(errno));
+        }
+    }
+}
+
+// See Fifo.h
+void Fifo::Start(int epoll_descr) {
+    _epoll_fd = epoll_descr;
+
+    struct epoll_event event;
+    event.events = _read_events = EPOLLIN;
+    event.data.ptr = this;
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _read_fd, &event)) {
+        throw std::runtime_error("Failed to add fifo to epoll");
+    }
+
+    // Pipe always has room for something unless reader is gone, so wait for it to take data out
+    if (_write_fd >= 0) {
+        event.events = EPOLLOUT | EPOLLET;
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _write_fd, &event)) {
+            throw std::runtime_error("Failed to add fifo to epoll");
+        }
+    }
+}
+
+// See Fifo.h
+void Fifo::Stop() {
+    _stopped = true;
+    UpdateEvents();
+}
+
+// See Fifo.h
+void Fifo::OnEvent(uint32_t events) {
+    if ((events & EPOLLOUT) && !Flush()) {
+        _logger->error("Failed to write fifo {}: {}", _write_path, strerror(errno));
+    }
+
+    // Writer has gone after sending the last data, which is still readable. Commands left in buffer by
+    // throttling must be run once reader has taken responses, even if nothing new arrives
+    if ((events & (EPOLLIN | EPOLLHUP)) || (_read_bytes > 0 && !_stopped && !Throttled())) {
+        DoRead();
+    }
+    UpdateEvents();
+}
+
+// See Fifo.h
+void Fifo::DoRead() {
+    Process();
+
+    std::size_t total = 0;
+    while (!_stopped && total < _read_budget) {
+        if (Throttled() && (!Flush() || Throttled())) {
+            break;
+        }
+
+        ssize_t bytes = read(_read_fd, _read_buffer + _read_bytes, sizeof(_read_buffer) - _read_bytes);
+        if (bytes == 0) {
+            Reopen();
+            break;
+        } else if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                _logger->error("Failed to read fifo {}: {}", _read_path, strerror(errno));
+            }
+            break;
+        }
+
+        _read_bytes += bytes;
+        total += bytes;
+        _logger->debug("Got {} bytes from fifo", bytes);
+        Process();
+    }
+
+    if (!Flush()) {
+        _logger->error("Failed to write fifo {}: {}", _write_path, strerror(errno));
+    }
+}
+
+// See Fifo.h
+void Fifo::Reopen() {
+    // Reader would wait for response forever otherwise
+    if (_stream.HasCommand()) {
+        _logger->debug("Drop incomplete data block left by fifo writer");
+        _output.Append("CLIENT_ERROR bad data chunk\r\n");
+    } else if (_read_bytes > 0 || _stream.Started()) {
+        _logger->debug("Drop incomplete command left by fifo writer");
+        _output.Append("ERROR\r\n");
+    }
+    _read_bytes = 0;
+    _stream.Reset();
+
+    // New reader goes first: with nobody holding the pipe open, data written meanwhile would be lost
+    int fd = OpenFifo(_read_path, O_RDONLY);
+    close(_read_fd);
+    _read_fd = fd;
+
+    struct epoll_event event;
+    event.events = _read_events;
+    event.data.ptr = this;
+    if (_read_events != 0 && epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _read_fd, &event)) {
+        _logger->error("Failed to add fifo to epoll: {}", strerror(errno));
+        _read_events = 0;
+    }
+}
+
+// See Fifo.h
+void Fifo::Process() {
+    // Rest of commands waits in buffer until reader takes responses
+    auto more = [this]() { return !Throttled(); };
+    auto execute = [this](Execute::Command &command, std::string &args, Execute::Response &output) {
+        command.Execute(*_pStorage, args, output);
+    };
+    std::size_t consumed = _stream.Process(_read_buffer, _read_bytes, _output, execute, more);
+    std::memmove(_read_buffer, _read_buffer + consumed, _read_bytes - consumed);
+    _read_bytes -= consumed;
+}
+
+// See Fifo.h
+bool Fifo::Flush() {
+    // Nobody is interested in responses
+    if (_write_fd < 0) {
+        _output.Clear();
+        return true;
+    }
+
+    Release();
+    struct iovec iov[64];
+    for (;;) {
+        if (_splicing.Empty() && _output.Size() >= SPLICE_MIN_SIZE) {
+            _splicing.Swap(_output);
+            _spliced = 0;
+        }
+
+        // Pipe takes references to response pages, so spliced data is never consumed nor modified until
+        // reader takes it out of the pipe
+        if (!_splicing.Empty()) {
+            ssize_t sent = vmsplice(_write_fd, iov, _splicing.Prepare(iov, 64, _spliced), SPLICE_F_NONBLOCK);
+            if (sent < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            _spliced += sent;
+            _pushed += sent;
+            if (_spliced == _splicing.Size()) {
+                _in_pipe.emplace_back();
+                _in_pipe.back().first = _pushed;
+                _in_pipe.back().second.Swap(_splicing);
+            }
+            continue;
+        }
+
+        if (_output.Empty()) {
+            return true;
+        }
+
+        ssize_t sent = writev(_write_fd, iov, _output.Prepare(iov, 64));
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        _output.Consume(sent);
+        _pushed += sent;
+    }
+}
+
+// See Fifo.h
+void Fifo::Release() {
+    int unread = 0;
+    if (_in_pipe.empty() || ioctl(_write_fd, FIONREAD, &unread) == -1) {
+        return;
+    }
+
+    // Everything pushed before the unread tail has been taken by reader
+    std::size_t taken = _pushed - unread;
+    while (!_in_pipe.empty() && _in_pipe.front().first <= taken) {
+        _in_pipe.pop_front();
+    }
+}
+
+// See Fifo.h
+void Fifo::UpdateEvents() {
+    uint32_t events = (_stopped || Throttled()) ? 0 : EPOLLIN;
+    if (events == _read_events) {
+        return;
+    }
+
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = this;
+    int op = (_read_events == 0) ? EPOLL_CTL_ADD : (events == 0) ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    if (epoll_ctl(_epoll_fd, op, _read_fd, &event)) {
+        _logger->error("Failed to change fifo events: {}", strerror(errno));
+        return;
+    }
+    _read_events = events;
+}
+
+// See Fifo.h
+bool Fifo::Throttled() {
+    std::size_t size = _output.Size() + _splicing.Size() - _spliced;
+    if (size >= _high_watermark) {
+        _throttled = true;
+    } else if (size < _low_watermark) {
+        _throttled = false;
+    }
+    return _throttled;
+}
+
+} // namespace STnonblock
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,154 @@
+#ifndef AFINA_NETWORK_ST_NONBLOCKING_FIFO_H
+#define AFINA_NETWORK_ST_NONBLOCKING_FIFO_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+#include <afina/network/Config.h>
+
+#include "network/CommandStream.h"
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Network {
+namespace STnonblock {
+
+/**
+ * # Command channel over named pipes
+ * Local loaders write commands into the read FIFO and take responses from the write FIFO, no TCP involved.
+ * Both pipes are served by the server epoll loop along with connections.
+ *
+ * Read FIFO is shared by writers which come and go. Once the last of them closes it, FIFO gets reopened,
+ * otherwise epoll would keep reporting hang up until the next writer shows up. Command left incomplete by
+ * the writer is dropped with an error response. Write FIFO is opened for both reading and writing, so it never fails for lack of
+ * reader and responses wait in the pipe for the next one.
+ *
+ * Large responses are moved into the pipe by vmsplice: pipe refers to response buffers instead of copying
+ * them, so such response is kept intact until reader takes all of it out of the pipe
+ */
+class Fifo {
+public:
+    Fifo(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<spdlog::logger> pl, const Config &config);
+    ~Fifo();
+
+    /**
+     * Opens pipes given in config, creating them if needed. Throws if either one can't be used
+     */
+    void Open();
+
+    /**
+     * Registers pipes in the given epoll instance, events are reported with this instance as a data
+     */
+    void Start(int epoll_descr);
+
+    /**
+     * Stop reading commands, responses to the ones already read are still sent
+     */
+    void Stop();
+
+    /**
+     * Serve events reported by epoll for either pipe
+     */
+    void OnEvent(uint32_t events);
+
+private:
+    // Size of the chunk read from the pipe at once
+    static const size_t READ_BUFFER_SIZE = 4096;
+
+    // Responses smaller than that are cheaper to copy than to pin their pages in the pipe
+    static const size_t SPLICE_MIN_SIZE = 64 * 1024;
+
+    void DoRead();
+
+    /**
+     * Replace read end once all writers are gone, so that epoll stops reporting hang up
+     */
+    void Reopen();
+
+    /**
+     * Execute all complete commands in the read buffer
+     */
+    void Process();
+
+    /**
+     * Push pending responses into the pipe without blocking, returns false if pipe is broken
+     */
+    bool Flush();
+
+    /**
+     * Free spliced responses which reader has already taken out of the pipe
+     */
+    void Release();
+
+    /**
+     * Recalculates events read end is registered for
+     */
+    void UpdateEvents();
+
+    /**
+     * Checks if reading commands must stop until responses are taken by reader
+     */
+    bool Throttled();
+
+    // afina services
+    std::shared_ptr<Afina::Storage> _pStorage;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Pipes paths, write one could be empty to drop responses
+    std::string _read_path;
+    std::string _write_path;
+
+    // Pipes descriptors and epoll instance they are registered in
+    int _read_fd;
+    int _write_fd;
+    int _epoll_fd;
+
+    // Limits, see Config.h
+    std::size_t _read_budget;
+    std::size_t _high_watermark;
+    std::size_t _low_watermark;
+
+    // Server has been asked to stop
+    bool _stopped;
+
+    // Output queue has hit high watermark and hasn't gone below low one yet
+    bool _throttled;
+
+    // Events read end is registered for now
+    uint32_t _read_events;
+
+    // Bytes read from the pipe but not processed yet
+    char _read_buffer[READ_BUFFER_SIZE];
+    std::size_t _read_bytes;
+
+    // Parse state of the stream
+    CommandStream _stream;
+
+    // Responses waiting to be sent
+    Execute::Response _output;
+
+    // Large response being spliced and number of its bytes already in the pipe
+    Execute::Response _splicing;
+    std::size_t _spliced;
+
+    // Spliced responses, each one with total number of bytes pushed into the pipe once it was done
+    std::deque<std::pair<std::size_t, Execute::Response>> _in_pipe;
+    std::size_t _pushed;
+};
+
+} // namespace STnonblock
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_ST_NONBLOCKING_FIFO_H
@@ -1,5 +1,7 @@
 #include "ServerImpl.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstring>
 #include <iostream>
@@ -22,14 +24,19 @@
 #include <afina/logging/Service.h>
 
 #include "Connection.h"
+#include "Fifo.h"
 #include "Utils.h"
+#include "network/Offload.h"
+#include "network/Unix.h"
 
 namespace Afina {
 namespace Network {
 namespace STnonblock {
 
 // See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl) : Server(ps, pl) {}
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl,
+                       std::shared_ptr<Config> pc)
+    : Server(ps, pl, pc), _server_socket(-1), _unix_socket(-1), _output_size(0), _idle(pc->idle_timeout) {}
 
 // See Server.h
 ServerImpl::~ServerImpl() {}
@@ -46,38 +53,42 @@ void ServerImpl::Start(uint16_t port, uint32_t n_acceptors, uint32_t n_workers)
         throw std::runtime_error("Unable to mask SIGPIPE");
     }
 
-    // Create server socket
-    struct sockaddr_in server_addr;
-    std::memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;         // IPv4
-    server_addr.sin_port = htons(port);       // TCP port number
-    server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
-
-    _server_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (_server_socket == -1) {
-        throw std::runtime_error("Failed to open socket: " + std::string(strerror(errno)));
+    // Socket handed over by the previous instance is already bound and listening
+    _server_socket = -1;
+    if (!pConfig->unix_only) {
+        _server_socket = pConfig->TakeListenSocket(AF_INET);
+        if (_server_socket >= 0) {
+            _logger->warn("Use inherited listening socket {}", _server_socket);
+            make_socket_non_blocking(_server_socket);
+        } else {
+            _server_socket = make_listen_socket(port);
+        }
     }
 
-    int opts = 1;
-    if (setsockopt(_server_socket, SOL_SOCKET, (SO_KEEPALIVE), &opts, sizeof(opts)) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket setsockopt() failed: " + std::string(strerror(errno)));
+    _unix_socket = -1;
+    if (!pConfig->unix_socket.empty()) {
+        _unix_socket = pConfig->TakeListenSocket(AF_UNIX);
+        if (_unix_socket >= 0) {
+            _logger->warn("Use inherited unix listening socket {}", _unix_socket);
+            make_socket_non_blocking(_unix_socket);
+        } else {
+            _unix_socket = make_unix_listen_socket(pConfig->unix_socket, SOCK_NONBLOCK);
+        }
     }
 
-    if (bind(_server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket bind() failed: " + std::string(strerror(errno)));
+    _event_fd = eventfd(0, EFD_NONBLOCK);
+    if (_event_fd == -1) {
+        throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
     }
 
-    make_socket_non_blocking(_server_socket);
-    if (listen(_server_socket, 5) == -1) {
-        close(_server_socket);
-        throw std::runtime_error("Socket listen() failed: " + std::string(strerror(errno)));
+    // Pipes are opened right away, so that bad paths fail startup rather than IO thread
+    if (!pConfig->read_fifo.empty()) {
+        _fifo.reset(new Fifo(pStorage, _logger, *pConfig));
+        _fifo->Open();
     }
 
-    _event_fd = eventfd(0, EFD_NONBLOCK);
-    if (_event_fd == -1) {
-        throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
+    if (pConfig->offload_threads > 0) {
+        _offload.reset(new Offload(pStorage, *pConfig));
     }
 
     _work_thread = std::thread(&ServerImpl::OnRun, this);
@@ -97,6 +108,22 @@ void ServerImpl::Stop() {
 void ServerImpl::Join() {
     // Wait for work to be complete
     _work_thread.join();
+    close(_server_socket);
+    close(_unix_socket);
+    close(_event_fd);
+    _fifo.reset();
+    _offload.reset();
+}
+
+// See Server.h
+std::vector<int> ServerImpl::ListenSockets() const {
+    std::vector<int> result;
+    for (int fd : {_server_socket, _unix_socket}) {
+        if (fd >= 0) {
+            result.push_back(fd);
+        }
+    }
+    return result;
 }
 
 // See ServerImpl.h
@@ -107,11 +134,13 @@ void ServerImpl::OnRun() {
         throw std::runtime_error("Failed to create epoll file descriptor: " + std::string(strerror(errno)));
     }
 
-    struct epoll_event event;
-    event.events = EPOLLIN;
-    event.data.fd = _server_socket;
-    if (epoll_ctl(epoll_descr, EPOLL_CTL_ADD, _server_socket, &event)) {
-        throw std::runtime_error("Failed to add file descriptor to epoll");
+    for (int fd : {_server_socket, _unix_socket}) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (fd >= 0 && epoll_ctl(epoll_descr, EPOLL_CTL_ADD, fd, &event)) {
+            throw std::runtime_error("Failed to add file descriptor to epoll");
+        }
     }
 
     struct epoll_event event2;
@@ -121,25 +150,52 @@ void ServerImpl::OnRun() {
         throw std::runtime_error("Failed to add file descriptor to epoll");
     }
 
-    bool run = true;
+    if (_fifo) {
+        _fifo->Start(epoll_descr);
+    }
+
+    if (_offload) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = _offload.get();
+        if (epoll_ctl(epoll_descr, EPOLL_CTL_ADD, _offload->EventFd(), &event)) {
+            throw std::runtime_error("Failed to add file descriptor to epoll");
+        }
+    }
+
+    bool stopping = false;
     std::array<struct epoll_event, 64> mod_list;
-    while (run) {
-        int nmod = epoll_wait(epoll_descr, &mod_list[0], mod_list.size(), -1);
+    std::vector<TimerWheel::Entry *> expired;
+    while (!stopping || !_connections.empty()) {
+        // Do not sleep while there are connections with unread data, nor past the moment idle ones must be closed
+        int nmod = epoll_wait(epoll_descr, &mod_list[0], mod_list.size(), _ready.empty() ? _idle.Timeout() : 0);
+        _idle.Update();
         _logger->debug("Acceptor wokeup: {} events", nmod);
 
         for (int i = 0; i < nmod; i++) {
             struct epoll_event &current_event = mod_list[i];
-            if (current_event.data.fd == _event_fd) {
-                _logger->debug("Break acceptor due to stop signal");
-                run = false;
+            if (_fifo && current_event.data.ptr == _fifo.get()) {
+                _fifo->OnEvent(current_event.events);
                 continue;
-            } else if (current_event.data.fd == _server_socket) {
-                OnNewConnection(epoll_descr);
+            } else if (_offload && current_event.data.ptr == _offload.get()) {
+                OnOffloaded(epoll_descr);
+                continue;
+            } else if (current_event.data.fd == _event_fd) {
+                if (!stopping) {
+                    stopping = true;
+                    OnStop(epoll_descr);
+                }
+                continue;
+            } else if (current_event.data.fd == _server_socket || current_event.data.fd == _unix_socket) {
+                OnNewConnection(epoll_descr, current_event.data.fd);
                 continue;
             }
 
-            // That is some connection!
+            // That is some connection! It could have been closed earlier in this round, e.g. once its job is done
             Connection *pc = static_cast<Connection *>(current_event.data.ptr);
+            if (!pc->isAlive()) {
+                continue;
+            }
 
             auto old_mask = pc->_event.events;
             if ((current_event.events & EPOLLERR) || (current_event.events & EPOLLHUP)) {
@@ -155,40 +211,127 @@ void ServerImpl::OnRun() {
                     pc->DoWrite();
                 }
             }
+            OnProcessed(epoll_descr, pc, old_mask);
+        }
 
-            // Does it alive?
+        // Connections stopped by read budget continue once everybody else got its turn
+        std::vector<Connection *> ready;
+        ready.swap(_ready);
+        for (Connection *pc : ready) {
+            pc->_in_ready = false;
             if (!pc->isAlive()) {
-                if (epoll_ctl(epoll_descr, EPOLL_CTL_DEL, pc->_socket, &pc->_event)) {
-                    _logger->error("Failed to delete connection from epoll");
-                }
+                delete pc;
+                continue;
+            } else if (!pc->isReady()) {
+                continue;
+            }
 
-                close(pc->_socket);
-                pc->OnClose();
+            auto old_mask = pc->_event.events;
+            pc->DoRead();
+            OnProcessed(epoll_descr, pc, old_mask);
+        }
 
-                delete pc;
-            } else if (pc->_event.events != old_mask) {
-                if (epoll_ctl(epoll_descr, EPOLL_CTL_MOD, pc->_socket, &pc->_event)) {
-                    _logger->error("Failed to change connection event mask");
+        _idle.Expire(expired);
+        for (TimerWheel::Entry *entry : expired) {
+            Connection *pc = static_cast<Connection *>(entry->owner);
+            auto old_mask = pc->_event.events;
+            pc->OnTimeout();
+            OnProcessed(epoll_descr, pc, old_mask);
+        }
+        expired.clear();
+    }
 
-                    close(pc->_socket);
-                    pc->OnClose();
+    // Whatever is left in ready list has been closed already
+    for (Connection *pc : _ready) {
+        delete pc;
+    }
+    _ready.clear();
+    _logger->warn("Acceptor stopped");
+}
 
-                    delete pc;
-                }
+// See ServerImpl.h
+void ServerImpl::OnStop(int epoll_descr) {
+    _logger->debug("Stop acceptor, {} connections left", _connections.size());
+
+    // Listening sockets stay open, connections waiting in their queues are left for the next instance if any
+    for (int fd : ListenSockets()) {
+        if (epoll_ctl(epoll_descr, EPOLL_CTL_DEL, fd, nullptr)) {
+            _logger->error("Failed to delete file descriptor from epoll");
+        }
+    }
+    if (epoll_ctl(epoll_descr, EPOLL_CTL_DEL, _event_fd, nullptr)) {
+        _logger->error("Failed to delete file descriptor from epoll");
+    }
+    if (_fifo) {
+        _fifo->Stop();
+    }
+
+    // Commands which have already arrived are still read, then connection sees end of stream and gets closed
+    // once all responses are sent
+    for (Connection *pc : _connections) {
+        shutdown(pc->_socket, SHUT_RD);
+    }
+}
+
+// See ServerImpl.h
+void ServerImpl::OnProcessed(int epoll_descr, Connection *pc, uint32_t old_mask) {
+    // Does it alive?
+    if (pc->isAlive()) {
+        _idle.Touch(&pc->_wheel);
+        if (pc->_event.events == old_mask || epoll_ctl(epoll_descr, EPOLL_CTL_MOD, pc->_socket, &pc->_event) == 0) {
+            // Connection which is already waiting for its turn could get here by epoll event
+            if (pc->isReady() && !pc->_in_ready) {
+                pc->_in_ready = true;
+                _ready.push_back(pc);
             }
+            return;
         }
+        _logger->error("Failed to change connection event mask");
+    } else if (epoll_ctl(epoll_descr, EPOLL_CTL_DEL, pc->_socket, &pc->_event)) {
+        _logger->error("Failed to delete connection from epoll");
+    }
+
+    close(pc->_socket);
+    pc->OnClose();
+
+    // Events of the current round could still refer to connection, so it is released once ready list is served
+    _connections.erase(pc);
+    _idle.Remove(&pc->_wheel);
+    if (!pc->_in_ready) {
+        pc->_in_ready = true;
+        _ready.push_back(pc);
     }
-    _logger->warn("Acceptor stopped");
 }
 
-void ServerImpl::OnNewConnection(int epoll_descr) {
+// See ServerImpl.h
+void ServerImpl::OnOffloaded(int epoll_descr) {
+    std::vector<Offload::Job *> jobs;
+    _offload->Done(jobs);
+    for (Offload::Job *job : jobs) {
+        // Connection has been closed while its command was executed, it could still wait to be released
+        Connection *pc = static_cast<Connection *>(job->owner);
+        if (pc == nullptr || !pc->isAlive()) {
+            if (pc != nullptr) {
+                pc->_job = nullptr;
+            }
+            delete job;
+            continue;
+        }
+
+        auto old_mask = pc->_event.events;
+        pc->OnOffloaded(job);
+        OnProcessed(epoll_descr, pc, old_mask);
+    }
+}
+
+void ServerImpl::OnNewConnection(int epoll_descr, int server_socket) {
     for (;;) {
-        struct sockaddr in_addr;
+        struct sockaddr_storage in_addr;
         socklen_t in_len;
 
         // No need to make these sockets non blocking since accept4() takes care of it.
         in_len = sizeof in_addr;
-        int infd = accept4(_server_socket, &in_addr, &in_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        int infd = accept4(server_socket, (struct sockaddr *)&in_addr, &in_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (infd == -1) {
             if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
                 break; // We have processed all incoming connections.
@@ -199,15 +342,17 @@ void ServerImpl::OnNewConnection(int epoll_descr) {
         }
 
         // Print host and service info.
-        char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
-        int retval =
-            getnameinfo(&in_addr, in_len, hbuf, sizeof hbuf, sbuf, sizeof sbuf, NI_NUMERICHOST | NI_NUMERICSERV);
-        if (retval == 0) {
-            _logger->info("Accepted connection on descriptor {} (host={}, port={})\n", infd, hbuf, sbuf);
+        if (_logger->should_log(spdlog::level::debug)) {
+            char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
+            int retval = getnameinfo((struct sockaddr *)&in_addr, in_len, hbuf, sizeof hbuf, sbuf, sizeof sbuf,
+                                     NI_NUMERICHOST | NI_NUMERICSERV);
+            if (retval == 0) {
+                _logger->debug("Accepted connection on descriptor {} (host={}, port={})\n", infd, hbuf, sbuf);
+            }
         }
 
         // Register the new FD to be monitored by epoll.
-        Connection *pc = new(std::nothrow) Connection(infd);
+        Connection *pc = new (std::nothrow) Connection(infd, pStorage, _logger, *pConfig, &_output_size, _offload.get());
         if (pc == nullptr) {
             throw std::runtime_error("Failed to allocate connection");
         }
@@ -217,8 +362,15 @@ void ServerImpl::OnNewConnection(int epoll_descr) {
         if (pc->isAlive()) {
             if (epoll_ctl(epoll_descr, EPOLL_CTL_ADD, pc->_socket, &pc->_event)) {
                 pc->OnError();
+                close(infd);
                 delete pc;
+            } else {
+                _connections.insert(pc);
+                _idle.Add(&pc->_wheel);
             }
+        } else {
+            close(infd);
+            delete pc;
         }
     }
 }
@@ -1,21 +1,33 @@
 #ifndef AFINA_NETWORK_ST_NONBLOCKING_SERVER_H
 #define AFINA_NETWORK_ST_NONBLOCKING_SERVER_H
 
+#include <atomic>
+#include <memory>
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include <afina/network/Server.h>
 
+#include "network/TimerWheel.h"
+
 namespace spdlog {
 class logger;
 }
 
 namespace Afina {
 namespace Network {
+
+// Forward declaration, see network/Offload.h
+class Offload;
+
 namespace STnonblock {
 
-// Forward declaration, see Worker.h
-class Worker;
+// Forward declaration, see Connection.h
+class Connection;
+
+// Forward declaration, see Fifo.h
+class Fifo;
 
 /**
  * # Network resource manager implementation
@@ -23,7 +35,7 @@ class Worker;
  */
 class ServerImpl : public Server {
 public:
-    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl);
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl, std::shared_ptr<Config> pc);
     ~ServerImpl();
 
     // See Server.h
@@ -35,9 +47,27 @@ public:
     // See Server.h
     void Join() override;
 
+    // See Server.h
+    std::vector<int> ListenSockets() const override;
+
 protected:
     void OnRun();
-    void OnNewConnection(int);
+    void OnNewConnection(int epoll_descr, int server_socket);
+
+    /**
+     * Stop accepting connections and let existing ones finish commands they have already sent
+     */
+    void OnStop(int epoll_descr);
+
+    /**
+     * Update connection events once it is done with current wakeup, release it if connection is closed
+     */
+    void OnProcessed(int epoll_descr, Connection *pc, uint32_t old_mask);
+
+    /**
+     * Hand results of heavy commands back to connections waiting for them
+     */
+    void OnOffloaded(int epoll_descr);
 
 private:
     // logger to use
@@ -51,11 +81,35 @@ private:
     // Socket to accept new connection on, shared between acceptors
     int _server_socket;
 
+    // Unix domain socket to accept connections from the same host on, -1 if there is none
+    int _unix_socket;
+
     // Curstom event "device" used to wakeup workers
     int _event_fd;
 
     // IO thread
     std::thread _work_thread;
+
+    // Command channel over named pipes, null if it is not configured
+    std::unique_ptr<Fifo> _fifo;
+
+    // Pool executing heavy commands, null if everything is executed by IO thread
+    std::unique_ptr<Offload> _offload;
+
+    // Total size of responses not sent yet, see Config::output_limit
+    std::atomic<std::size_t> _output_size;
+
+    // Connections to be closed once idle for too long
+    TimerWheel _idle;
+
+    // All connections being served
+    std::unordered_set<Connection *> _connections;
+
+    // Connections which have exhausted read budget and must be served again without waiting for epoll. Every
+    // connection is listed at most once, see Connection::_in_ready. Entries aren't removed when connection
+    // drains its socket, they are skipped once list is served. Closed connections are listed as well and get
+    // released there
+    std::vector<Connection *> _ready;
 };
 
 } // namespace STnonblock
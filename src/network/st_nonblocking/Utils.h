@@ -1,12 +1,19 @@
 #ifndef AFINA_NETWORK_ST_NONBLOCKING_UTILS_H
 #define AFINA_NETWORK_ST_NONBLOCKING_UTILS_H
 
+#include <cstdint>
+
 namespace Afina {
 namespace Network {
 namespace STnonblock {
 
 void make_socket_non_blocking(int sfd);
 
+/**
+ * Creates non blocking socket listening for TCP connections on the given port
+ */
+int make_listen_socket(uint16_t port);
+
 } // namespace STnonblock
 } // namespace Network
 } // namespace Afina
@@ -0,0 +1,60 @@
+#ifndef AFINA_NETWORK_UDP_SERVER_H
+#define AFINA_NETWORK_UDP_SERVER_H
+
+#include <memory>
+#include <vector>
+
+#include <afina/network/Server.h>
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+namespace Network {
+namespace UDP {
+
+// Forward declaration, see Worker.h
+class Worker;
+
+/**
+ * # Memcached UDP frontend
+ * Serves requests sent in datagrams, each one prefixed by memcached UDP frame header. There is no
+ * connection to set up, so short lived clients doing a couple of lookups don't pay for TCP handshake.
+ *
+ * Runs along with one of TCP servers on the same port. Each worker thread has its own SO_REUSEPORT
+ * socket, so kernel spreads clients between workers
+ */
+class ServerImpl : public Server {
+public:
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Logging::Service> pl, std::shared_ptr<Config> pc);
+    ~ServerImpl();
+
+    // See Server.h
+    void Start(uint16_t port, uint32_t acceptors, uint32_t workers) override;
+
+    // See Server.h
+    void Stop() override;
+
+    // See Server.h
+    void Join() override;
+
+private:
+    // logger to use
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Curstom event "device" used to wakeup workers
+    int _event_fd;
+
+    // Sockets owned by workers
+    std::vector<int> _sockets;
+
+    // Threads serving datagrams
+    std::vector<Worker> _workers;
+};
+
+} // namespace UDP
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_UDP_SERVER_H
@@ -0,0 +1,267 @@
+#include "Worker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/logger.h>
+
+#include <afina/Storage.h>
+#include <afina/logging/Service.h>
+
+namespace Afina {
+namespace Network {
+namespace UDP {
+
+// Number of datagrams received and processed at once
+static const size_t BATCH_SIZE = 32;
+
+// Max size of a request, bigger ones get truncated by kernel and rejected
+static const size_t MAX_REQUEST_SIZE = 8192;
+
+// See Worker.h
+Worker::Worker(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Afina::Logging::Service> pl)
+    : _pStorage(ps), _pLogging(pl), _socket(-1), _event_fd(-1) {}
+
+// See Worker.h
+Worker::~Worker() {}
+
+// See Worker.h
+Worker::Worker(Worker &&other) { *this = std::move(other); }
+
+// See Worker.h
+Worker &Worker::operator=(Worker &&other) {
+    _pStorage = std::move(other._pStorage);
+    _pLogging = std::move(other._pLogging);
+    _logger = std::move(other._logger);
+    _thread = std::move(other._thread);
+    _socket = other._socket;
+    _event_fd = other._event_fd;
+
+    other._socket = -1;
+    other._event_fd = -1;
+    return *this;
+}
+
+// See Worker.h
+void Worker::Start(int socket, int event_fd) {
+    assert(!_thread.joinable());
+    _socket = socket;
+    _event_fd = event_fd;
+    _logger = _pLogging->select("network.worker");
+    _thread = std::thread(&Worker::OnRun, this);
+}
+
+// See Worker.h
+void Worker::Join() {
+    assert(_thread.joinable());
+    _thread.join();
+}
+
+// See Worker.h
+void Worker::OnRun() {
+    _logger->trace("OnRun");
+
+    // Buffers are allocated once worker is in place, so that message headers could point into them
+    _requests.resize(BATCH_SIZE * MAX_REQUEST_SIZE);
+    _senders.resize(BATCH_SIZE);
+    _recv_msgs.resize(BATCH_SIZE);
+    _recv_iov.resize(BATCH_SIZE);
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+        _recv_iov[i].iov_base = &_requests[i * MAX_REQUEST_SIZE];
+        _recv_iov[i].iov_len = MAX_REQUEST_SIZE;
+        std::memset(&_recv_msgs[i], 0, sizeof(_recv_msgs[i]));
+        _recv_msgs[i].msg_hdr.msg_iov = &_recv_iov[i];
+        _recv_msgs[i].msg_hdr.msg_iovlen = 1;
+        _recv_msgs[i].msg_hdr.msg_name = &_senders[i];
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = _socket;
+    fds[1].fd = _event_fd;
+    fds[0].events = fds[1].events = POLLIN;
+    for (;;) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _logger->error("Failed to wait for datagrams: {}", strerror(errno));
+            break;
+        }
+
+        // Event is never consumed, so that all workers see it
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < BATCH_SIZE; i++) {
+            _recv_msgs[i].msg_hdr.msg_namelen = sizeof(_senders[i]);
+            _recv_msgs[i].msg_hdr.msg_flags = 0;
+        }
+        int n = recvmmsg(_socket, &_recv_msgs[0], BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        if (n == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                _logger->error("Failed to receive datagrams: {}", strerror(errno));
+            }
+            continue;
+        }
+
+        _logger->debug("Got {} datagrams", n);
+        for (int i = 0; i < n; i++) {
+            OnRequest(i, _recv_msgs[i].msg_len, _recv_msgs[i].msg_hdr.msg_flags);
+        }
+        Flush();
+    }
+    _logger->warn("Worker stopped");
+}
+
+// See Worker.h
+void Worker::OnRequest(size_t i, size_t size, int flags) {
+    // Nowhere to send response to without request id
+    const unsigned char *header = reinterpret_cast<const unsigned char *>(&_requests[i * MAX_REQUEST_SIZE]);
+    if (size < HEADER_SIZE) {
+        _logger->debug("Drop datagram of {} bytes", size);
+        return;
+    }
+
+    uint16_t request_id = (header[0] << 8) | header[1];
+    uint16_t total = (header[4] << 8) | header[5];
+    if (total != 1) {
+        _output.Append("SERVER_ERROR multi-packet request not supported\r\n");
+    } else if (flags & MSG_TRUNC) {
+        _output.Append("SERVER_ERROR request too large\r\n");
+    } else {
+        Process(reinterpret_cast<const char *>(header) + HEADER_SIZE, size - HEADER_SIZE);
+    }
+    Reply(i, request_id);
+}
+
+// See Worker.h
+void Worker::Process(const char *data, size_t size) {
+    _parser.Reset();
+    while (size > 0) {
+        std::size_t parsed = 0;
+        bool done = _parser.Parse(data, size, parsed);
+        data += parsed;
+        size -= parsed;
+        if (!done) {
+            // Request never continues in the next datagram
+            _output.Append("CLIENT_ERROR bad command line format\r\n");
+            break;
+        }
+
+        if (_parser.Failed()) {
+            // Broken line has been skipped, let client know and keep going with the next one
+            _parser.BuildError(_output);
+            _parser.Reset();
+            continue;
+        }
+
+        // Data block must be in the same datagram and terminated by \r\n
+        std::size_t body_size = 0;
+        _parser.Build(body_size, _command);
+        if (_command.HasBody()) {
+            if (size < body_size + 2 || data[body_size] != '\r' || data[body_size + 1] != '\n') {
+                _output.Append("CLIENT_ERROR bad data chunk\r\n");
+                break;
+            }
+            _argument.assign(data, body_size);
+            data += body_size + 2;
+            size -= body_size + 2;
+        }
+        _command.Execute(*_pStorage, _argument, _output);
+
+        // Prepare for the next command
+        _command.Reset();
+        _argument.resize(0);
+        _parser.Reset();
+    }
+
+    _command.Reset();
+    _argument.resize(0);
+}
+
+// See Worker.h
+void Worker::Reply(size_t i, uint16_t request_id) {
+    // Datagrams are counted by 16 bit field
+    if (_output.Size() > 0xffff * MAX_PAYLOAD) {
+        _output.Clear();
+        _output.Append("SERVER_ERROR object too large for cache\r\n");
+    }
+
+    // Response is copied once, so that datagram boundaries don't have to match its segments
+    size_t offset = _payload.size();
+    struct iovec iov[64];
+    while (!_output.Empty()) {
+        size_t cnt = _output.Prepare(iov, 64);
+        size_t bytes = 0;
+        for (size_t j = 0; j < cnt; j++) {
+            _payload.append(static_cast<const char *>(iov[j].iov_base), iov[j].iov_len);
+            bytes += iov[j].iov_len;
+        }
+        _output.Consume(bytes);
+    }
+
+    size_t size = _payload.size() - offset;
+    size_t total = (size + MAX_PAYLOAD - 1) / MAX_PAYLOAD;
+    for (size_t seq = 0; seq < total; seq++) {
+        Datagram d;
+        d.request = i;
+        d.offset = offset + seq * MAX_PAYLOAD;
+        d.size = std::min(size - seq * MAX_PAYLOAD, size_t(MAX_PAYLOAD));
+        d.header[0] = request_id >> 8;
+        d.header[1] = request_id & 0xff;
+        d.header[2] = seq >> 8;
+        d.header[3] = seq & 0xff;
+        d.header[4] = total >> 8;
+        d.header[5] = total & 0xff;
+        d.header[6] = d.header[7] = 0;
+        _datagrams.push_back(d);
+    }
+}
+
+// See Worker.h
+void Worker::Flush() {
+    // Payload doesn't move anymore, so messages could point into it
+    _send_msgs.resize(_datagrams.size());
+    _send_iov.resize(2 * _datagrams.size());
+    for (size_t i = 0; i < _datagrams.size(); i++) {
+        Datagram &d = _datagrams[i];
+        _send_iov[2 * i].iov_base = d.header;
+        _send_iov[2 * i].iov_len = HEADER_SIZE;
+        _send_iov[2 * i + 1].iov_base = &_payload[d.offset];
+        _send_iov[2 * i + 1].iov_len = d.size;
+
+        std::memset(&_send_msgs[i], 0, sizeof(_send_msgs[i]));
+        _send_msgs[i].msg_hdr.msg_iov = &_send_iov[2 * i];
+        _send_msgs[i].msg_hdr.msg_iovlen = 2;
+        _send_msgs[i].msg_hdr.msg_name = &_senders[d.request];
+        _send_msgs[i].msg_hdr.msg_namelen = _recv_msgs[d.request].msg_hdr.msg_namelen;
+    }
+
+    // Socket is blocking for writes, so kernel takes them all unless something is really wrong
+    size_t sent = 0;
+    while (sent < _send_msgs.size()) {
+        int n = sendmmsg(_socket, &_send_msgs[sent], _send_msgs.size() - sent, 0);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _logger->error("Failed to send datagrams: {}", strerror(errno));
+            break;
+        }
+        sent += n;
+    }
+
+    _payload.clear();
+    _datagrams.clear();
+}
+
+} // namespace UDP
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,144 @@
+#ifndef AFINA_NETWORK_UDP_WORKER_H
+#define AFINA_NETWORK_UDP_WORKER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include "protocol/Parser.h"
+
+namespace spdlog {
+class logger;
+}
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+namespace Logging {
+class Service;
+}
+
+namespace Network {
+namespace UDP {
+
+/**
+ * # Thread serving datagrams
+ * Receives a batch of requests by a single recvmmsg, executes all commands of each one and sends all
+ * response datagrams of the batch by sendmmsg.
+ *
+ * Request must fit into a single datagram, so every request is parsed from scratch. Response is split
+ * into datagrams of at most MAX_PAYLOAD bytes, each one gets frame header with the request id of the
+ * request, its own sequence number and total number of datagrams in the response
+ */
+class Worker {
+public:
+    // Size of memcached UDP frame header
+    static const size_t HEADER_SIZE = 8;
+
+    // Max size of a response datagram payload, memcached keeps datagrams under typical MTU
+    static const size_t MAX_PAYLOAD = 1400 - HEADER_SIZE;
+
+    Worker(std::shared_ptr<Afina::Storage> ps, std::shared_ptr<Afina::Logging::Service> pl);
+    ~Worker();
+
+    Worker(Worker &&);
+    Worker &operator=(Worker &&);
+
+    /**
+     * Spaws background thread serving datagrams on the given socket. Once event_fd becomes readable
+     * worker finishes current batch and exits
+     */
+    void Start(int socket, int event_fd);
+
+    /**
+     * Blocks calling thread until background one for this worker is actually
+     * been destoryed
+     */
+    void Join();
+
+protected:
+    /**
+     * Method executing by background thread
+     */
+    void OnRun();
+
+    /**
+     * Serve i-th datagram of the received batch, response datagrams are queued
+     */
+    void OnRequest(size_t i, size_t size, int flags);
+
+    /**
+     * Execute all commands of the request payload, responses are collected in _output
+     */
+    void Process(const char *data, size_t size);
+
+    /**
+     * Move content of _output into datagrams addressed to the sender of i-th request
+     */
+    void Reply(size_t i, uint16_t request_id);
+
+    /**
+     * Send all queued datagrams
+     */
+    void Flush();
+
+private:
+    Worker(Worker &) = delete;
+    Worker &operator=(Worker &) = delete;
+
+    // Part of the response, refers to the payload buffer
+    struct Datagram {
+        size_t request;
+        size_t offset;
+        size_t size;
+        unsigned char header[HEADER_SIZE];
+    };
+
+    // afina services
+    std::shared_ptr<Afina::Storage> _pStorage;
+    std::shared_ptr<Afina::Logging::Service> _pLogging;
+
+    // Logger to be used
+    std::shared_ptr<spdlog::logger> _logger;
+
+    // Thread serving requests in this worker
+    std::thread _thread;
+
+    // Socket to receive requests on and descriptor signalling stop
+    int _socket;
+    int _event_fd;
+
+    // Requests of the current batch and their senders
+    std::vector<char> _requests;
+    std::vector<struct sockaddr_storage> _senders;
+    std::vector<struct mmsghdr> _recv_msgs;
+    std::vector<struct iovec> _recv_iov;
+
+    // Parse state, reset for each request
+    Protocol::Parser _parser;
+    Execute::Command _command;
+    std::string _argument;
+
+    // Responses of the request being processed
+    Execute::Response _output;
+
+    // Payload of all responses of the current batch and datagrams it is split into
+    std::string _payload;
+    std::vector<Datagram> _datagrams;
+    std::vector<struct mmsghdr> _send_msgs;
+    std::vector<struct iovec> _send_iov;
+};
+
+} // namespace UDP
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_UDP_WORKER_H
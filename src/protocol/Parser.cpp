@@ -1,16 +1,10 @@
 #include "Parser.h"
 
+#include <cstdint>
 #include <iostream>
-#include <sstream>
-#include <stdexcept>
 
-#include <afina/execute/Add.h>
-#include <afina/execute/Append.h>
 #include <afina/execute/Command.h>
-#include <afina/execute/Delete.h>
-#include <afina/execute/Get.h>
-#include <afina/execute/Set.h>
-#include <afina/execute/Stats.h>
+#include <afina/execute/Response.h>
 
 namespace Afina {
 namespace Protocol {
@@ -24,55 +18,112 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
         char c = input[pos];
         // std::cout << "[" << pos << "] '" << c << "': state=" << int(state) << std::endl;
 
+        // Line ends before command is complete, there is nothing to skip so report error right away
+        if (c == '\n' && state != State::sLF && state != State::sSkip) {
+            if (error == Error::kNone) {
+                error = (state == State::sName) ? Error::kUnknownCommand : Error::kBadFormat;
+            }
+            state = State::sSkip;
+            parse_complete = true;
+            continue;
+        }
+
         switch (state) {
         case State::sName: {
             if (c == ' ' || c == '\r') {
                 // std::cout << "parser debug: name='" << name << "'" << std::endl;
-                if (name == "set" || name == "add" || name == "append" || name == "prepend") {
-                    state = State::spKey;
-                } else if (name == "get" || name == "gets") {
+                switch (name_code) {
+                case PackName("set"):
+                    type = Execute::Command::Type::kSet;
+                    break;
+                case PackName("add"):
+                    type = Execute::Command::Type::kAdd;
+                    break;
+                case PackName("append"):
+                    type = Execute::Command::Type::kAppend;
+                    break;
+                case PackName("prepend"):
+                    type = Execute::Command::Type::kPrepend;
+                    break;
+                case PackName("replace"):
+                    type = Execute::Command::Type::kReplace;
+                    break;
+                case PackName("cas"):
+                    type = Execute::Command::Type::kCas;
+                    break;
+                case PackName("get"):
+                    type = Execute::Command::Type::kGet;
+                    break;
+                case PackName("gets"):
+                    type = Execute::Command::Type::kGets;
+                    break;
+                case PackName("stats"):
+                    type = Execute::Command::Type::kStats;
+                    break;
+                default:
+                    Fail(Error::kUnknownCommand);
+                    continue;
+                }
+
+                if (type == Execute::Command::Type::kGet || type == Execute::Command::Type::kGets) {
                     state = State::sgKey;
-                } else if (name == "stats") {
+                } else if (type == Execute::Command::Type::kStats) {
                     state = State::sLF;
-                    continue;
                 } else {
-                    throw std::runtime_error("Unknown command name: " + name);
+                    state = State::spKey;
                 }
+            } else if (c != '\0' && name_length < MAX_NAME_LENGTH) {
+                name[name_length++] = c;
+                name[name_length] = '\0';
+                name_code = (name_code << 8) | uint8_t(c);
             } else {
-                name.push_back(c);
+                Fail(Error::kUnknownCommand);
             }
             break;
         }
 
         case State::spKey: {
             if (c == ' ') {
+                if (curKey.empty()) {
+                    Fail(Error::kBadFormat);
+                    break;
+                }
                 state = State::spFlags;
-                keys.push_back(curKey);
+                PushKey();
                 // std::cout << "parser debug: key[" << keys.size() - 1 << "]='" << curKey << "'" << std::endl;
-            } else {
+            } else if (c == '\r') {
+                Fail(Error::kBadFormat);
+            } else if (curKey.size() < MAX_KEY_LENGTH) {
                 curKey.push_back(c);
+            } else {
+                Fail(Error::kKeyTooLong);
             }
             break;
         }
 
         case State::sgKey: {
             if (c == '\r') {
-                keys.push_back(curKey);
-                // std::cout << "parser debug: total '" << keys.size() << " keys" << std::endl;
+                if (!curKey.empty()) {
+                    PushKey();
+                }
+                // std::cout << "parser debug: total '" << nkeys << " keys" << std::endl;
 
-                if (keys.size() == 0) {
-                    throw std::runtime_error("Client provides no key to retrive");
+                if (nkeys == 0) {
+                    // Client provides no key to retrive
+                    Fail(Error::kBadFormat);
+                    break;
                 }
 
-                curKey.clear();
                 state = State::sLF;
             } else if (c == ' ') {
-                // std::cout << "parser debug: key[" << keys.size() << "]='" << curKey << "'" << std::endl;
-                state = State::sgKey;
-                keys.push_back(curKey);
-                curKey.clear();
-            } else {
+                // std::cout << "parser debug: key[" << nkeys << "]='" << curKey << "'" << std::endl;
+                if (!curKey.empty()) {
+                    PushKey();
+                }
+            } else if (curKey.size() < MAX_KEY_LENGTH) {
                 curKey.push_back(c);
+            } else {
+                Fail(Error::kKeyTooLong);
             }
             break;
         }
@@ -83,12 +134,14 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
                 state = State::spExprTimeStart;
                 // std::cout << "parser debug: flags='" << flags << "'" << std::endl;
             } else if (c >= '0' && c <= '9') {
-                uint32_t f = (flags * 10) + (c - '0');
-                if (f < flags) {
-                    // Overflow
-                    throw std::runtime_error("Flags field overflow");
+                uint32_t d = c - '0';
+                if (flags > (UINT32_MAX - d) / 10) {
+                    Fail(Error::kOverflow);
+                    break;
                 }
-                flags = f;
+                flags = flags * 10 + d;
+            } else {
+                Fail(Error::kBadFormat);
             }
             break;
         }
@@ -100,6 +153,8 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             } else if (c >= '0' && c <= '9') {
                 exprtime = (c - '0');
                 state = State::spExprTime;
+            } else if (c != ' ') {
+                Fail(Error::kBadFormat);
             }
             break;
         }
@@ -109,34 +164,58 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
                 state = State::spBytes;
                 // std::cout << "parser debug: ExprTime='" << exprtime << "'" << std::endl;
             } else if (c >= '0' && c <= '9') {
-                int32_t et = exprtime;
+                int32_t d = c - '0';
                 if (negative) {
-                    et -= (c - '0');
-                    if (et > exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
+                    if (exprtime < (INT32_MIN + d) / 10) {
+                        Fail(Error::kOverflow);
+                        break;
                     }
+                    exprtime = exprtime * 10 - d;
                 } else {
-                    et += (c - '0');
-                    if (et < exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
+                    if (exprtime > (INT32_MAX - d) / 10) {
+                        Fail(Error::kOverflow);
+                        break;
                     }
+                    exprtime = exprtime * 10 + d;
                 }
-                exprtime = et;
+            } else {
+                Fail(Error::kBadFormat);
             }
             break;
         }
 
         case State::spBytes: {
-            if (c == '\r') {
+            if (c == '\r' && type != Execute::Command::Type::kCas) {
                 state = State::sLF;
                 // std::cout << "parser debug: bytes='" << bytes << "'" << std::endl;
+            } else if (c == ' ' && type == Execute::Command::Type::kCas) {
+                state = State::scUnique;
             } else if (c >= '0' && c <= '9') {
-                uint32_t b = (bytes * 10) + (c - '0');
-                if (b < bytes) {
-                    // Overflow
-                    throw std::runtime_error("Bytes field overflow");
+                uint32_t d = c - '0';
+                if (bytes > (UINT32_MAX - d) / 10) {
+                    Fail(Error::kOverflow);
+                    break;
                 }
-                bytes = b;
+                bytes = bytes * 10 + d;
+            } else {
+                Fail(Error::kBadFormat);
+            }
+            break;
+        }
+
+        case State::scUnique: {
+            if (c == '\r') {
+                state = State::sLF;
+                // std::cout << "parser debug: cas='" << cas << "'" << std::endl;
+            } else if (c >= '0' && c <= '9') {
+                uint64_t d = c - '0';
+                if (cas > (UINT64_MAX - d) / 10) {
+                    Fail(Error::kOverflow);
+                    break;
+                }
+                cas = cas * 10 + d;
+            } else {
+                Fail(Error::kBadFormat);
             }
             break;
         }
@@ -145,15 +224,21 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             if (c == '\n') {
                 parse_complete = true;
             } else {
-                std::stringstream err;
-                err << "Invalid char " << (int)c << " at position " << (parsed + pos) << ", \\n expected";
-                throw std::runtime_error(err.str());
+                // \n expected
+                Fail(Error::kBadFormat);
+            }
+            break;
+        }
+
+        case State::sSkip: {
+            if (c == '\n') {
+                parse_complete = true;
             }
             break;
         }
 
         default:
-            throw std::runtime_error("Unknown state");
+            Fail(Error::kBadFormat);
         }
     }
 
@@ -162,37 +247,51 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
 }
 
 // See Parse.h
-std::unique_ptr<Execute::Command> Parser::Build(size_t &body_size) const {
-    if (state != State::sLF) {
-        return std::unique_ptr<Execute::Command>(nullptr);
+bool Parser::Build(size_t &body_size, Execute::Command &command) {
+    if (state != State::sLF || error != Error::kNone || type == Execute::Command::Type::kNone) {
+        return false;
     }
 
     body_size = bytes;
-    if (name == "set") {
-        return std::unique_ptr<Execute::Command>(new Execute::Set(keys[0], flags, exprtime));
-    } else if (name == "add") {
-        return std::unique_ptr<Execute::Command>(new Execute::Add(keys[0], flags, exprtime));
-    } else if (name == "append") {
-        return std::unique_ptr<Execute::Command>(new Execute::Append(keys[0], flags, exprtime));
-    } else if (name == "get") {
-        return std::unique_ptr<Execute::Command>(new Execute::Get(keys));
-    } else if (name == "stats") {
-        return std::unique_ptr<Execute::Command>(new Execute::Stats());
-    } else {
-        throw std::runtime_error("Unsupported command");
+    command.Assign(type, keys, nkeys, flags, exprtime, cas);
+    nkeys = 0;
+    return true;
+}
+
+// See Parse.h
+void Parser::BuildError(Execute::Response &out) const {
+    switch (error) {
+    case Error::kNone:
+        break;
+    case Error::kUnknownCommand:
+        out.Append("ERROR\r\n");
+        break;
+    case Error::kOverflow:
+        out.Append("CLIENT_ERROR numeric field out of range\r\n");
+        break;
+    case Error::kKeyTooLong:
+        out.Append("CLIENT_ERROR key too long\r\n");
+        break;
+    default:
+        out.Append("CLIENT_ERROR bad command line format\r\n");
     }
 }
 
 // See Parse.h
 void Parser::Reset() {
     state = State::sName;
-    name.clear();
-    keys.clear();
+    error = Error::kNone;
+    name[0] = '\0';
+    name_length = 0;
+    name_code = 0;
+    type = Execute::Command::Type::kNone;
+    nkeys = 0;
     curKey.clear();
     parse_complete = false;
     flags = 0;
     bytes = 0;
     exprtime = 0;
+    cas = 0;
 }
 
 } // namespace Protocol
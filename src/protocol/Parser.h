@@ -1,17 +1,15 @@
 #ifndef AFINA_PROTOCOL_PARSER_H
 #define AFINA_PROTOCOL_PARSER_H
 
-#include <memory>
 #include <string>
 #include <vector>
 
 #include <cstddef>
 #include <cstdint>
 
+#include <afina/execute/Command.h>
+
 namespace Afina {
-namespace Execute {
-class Command;
-} // namespace Execute
 namespace Protocol {
 
 /**
@@ -20,6 +18,44 @@ namespace Protocol {
  */
 class Parser {
 public:
+    /**
+     * Kind of problem found in the input stream. Parser never throws on malformed input, instead
+     * it skips everything up to the end of the broken line and reports what has happened, so that
+     * connection could answer with an error and keep processing next commands
+     */
+    enum class Error : uint8_t {
+        // No error, command parsed out successfully
+        kNone,
+
+        // Command name is not known, memcached answers "ERROR" in a such case
+        kUnknownCommand,
+
+        // Command line doesn't match command syntax
+        kBadFormat,
+
+        // Some numeric field doesn't fit its type
+        kOverflow,
+
+        // Key is longer than protocol allows
+        kKeyTooLong
+    };
+
+    // Maximum length of the key allowed by memcached protocol
+    static const size_t MAX_KEY_LENGTH = 250;
+
+    // Maximum length of the command name, anything longer is definitely unknown. Whole name must fit
+    // into uint64_t, see PackName
+    static const size_t MAX_NAME_LENGTH = 8;
+
+    /**
+     * Packs command name into integer, one byte per char, so that name could be recognized by a single
+     * switch instead of chain of string comparisons. Names are at most MAX_NAME_LENGTH chars long, so
+     * packing is unique
+     */
+    static constexpr uint64_t PackName(const char *name, uint64_t code = 0) {
+        return (*name == '\0') ? code : PackName(name + 1, (code << 8) | uint8_t(*name));
+    }
+
     Parser() { Reset(); }
     /**
      * Push given string into parser input. Method returns true if it was a command parsed out
@@ -38,22 +74,43 @@ public:
      * @param input string to be added to the parsed input
      * @param size number of bytes in the input buffer that could be read
      * @param parsed output parameter tells how many bytes was consumed from the string
-     * @return true if command has been parsed out
+     * @return true if command has been parsed out, or broken line has been skipped. Use Failed()
+     * to distinguish between those cases
      */
     bool Parse(const char *input, const size_t size, size_t &parsed);
 
     /**
-     * Builds new command from parsed input. In case if it wasn't enough input to prse command out
-     * method return nullptr
+     * Builds new command from parsed input into the given instance. In case if it wasn't enough input
+     * to prse command out or input was malformed method returns false and leave command untouched.
+     *
+     * Command is reused, no memory allocated as long as command buffers are big enough
+     */
+    bool Build(size_t &body_size, Execute::Command &command);
+
+    /**
+     * Returns true if last line pushed into parser was malformed. In a such case there is no
+     * command to build and BuildError should be used to get response for the client
      */
-    std::unique_ptr<Execute::Command> Build(size_t &body_size) const;
+    inline bool Failed() const { return error != Error::kNone; }
+
+    inline Error GetError() const { return error; }
+
+    /**
+     * Returns true if parser has consumed some part of the line which isn't complete yet
+     */
+    inline bool Started() const { return state != State::sName || name_length > 0; }
+
+    /**
+     * Appends response client should get for the malformed input to the given output
+     */
+    void BuildError(Execute::Response &out) const;
 
     /**
      * Reset parse so that it could be used to parse out new command
      */
     void Reset();
 
-    inline const std::string &Name() const { return name; }
+    inline const char *Name() const { return name; }
 
 private:
     /**
@@ -61,15 +118,62 @@ private:
      * - s: state for PUT and GET commands
      * - sp: for PUT commands only
      * - sg: for GET commands only
+     * - sc: for CAS command only
+     *
+     * sSkip is used to drop rest of the malformed line until \n
+     */
+    enum State : uint16_t {
+        sCR,
+        sLF,
+        sName,
+        spKey,
+        spFlags,
+        spExprTimeStart,
+        spExprTime,
+        spBytes,
+        scUnique,
+        sgKey,
+        sSkip
+    };
+
+    /**
+     * Append key collected so far to the keys list, reusing string from the previous commands if possible
+     */
+    inline void PushKey() {
+        if (nkeys < keys.size()) {
+            keys[nkeys].assign(curKey);
+        } else {
+            keys.push_back(curKey);
+        }
+        nkeys++;
+        curKey.clear();
+    }
+
+    /**
+     * Remember given error and switch parser to skip rest of the current line
      */
-    enum State : uint16_t { sCR, sLF, sName, spKey, spFlags, spExprTimeStart, spExprTime, spBytes, sgKey };
+    inline void Fail(Error err) {
+        error = err;
+        state = State::sSkip;
+    }
 
     // Current parser state
     State state;
 
+    // Problem found in the current line, if any
+    Error error;
+
     // vrious fields of the command
-    std::string name;
+    char name[MAX_NAME_LENGTH + 1];
+    size_t name_length;
+
+    // Command name packed by PackName, while name is parsed. Once name is complete it gets resolved into type
+    uint64_t name_code;
+    Execute::Command::Type type;
+
+    // Keys of the command, only first nkeys are valid. Strings are never released to keep their buffers
     std::vector<std::string> keys;
+    size_t nkeys;
 
     // <flags> is an arbitrary 16-bit unsigned integer (written out in decimal) that the server stores along with
     // the data and sends back when the item is retrieved. Clients may use this as a bit field to store data-specific
@@ -88,6 +192,10 @@ private:
     // it's followed by an empty data block).
     uint32_t bytes;
 
+    // <cas unique> is a unique 64-bit value of an existing entry, client should use the value returned from
+    // the "gets" command when issuing "cas" updates
+    uint64_t cas;
+
     bool negative;
     std::string curKey;
     bool parse_complete;
@@ -52,7 +52,7 @@ void SimpleLRU::move_node_tail(SimpleLRU::lru_node &node_found) {
     }
 }
 
-bool SimpleLRU::_set_anyway(lru_node& node_found, const std::string &value) {
+bool SimpleLRU::_set_anyway(lru_node& node_found, std::string value) {
     move_node_tail(node_found);
 
     if (node_found.key.size() + value.size() > _max_size) { //checking size
@@ -63,18 +63,19 @@ bool SimpleLRU::_set_anyway(lru_node& node_found, const std::string &value) {
         delete_lru();
     }
     _cur_size = _cur_size + value.size() - node_found.value.size();
-    node_found.value = value;
+    node_found.value = std::move(value);
+    node_found.version = ++_version;
 
     return true;
 }
 
-bool SimpleLRU::_put_anyway(const std::string &key, const std::string &value) {
+bool SimpleLRU::_put_anyway(const std::string &key, std::string value) {
     size_t ovr_size = key.size() + value.size();
 
     //case storage is empty
     if (_lru_head == nullptr and _lru_tail == nullptr) {
         if (ovr_size <= _max_size) {
-            auto new_node = new lru_node{key, value, nullptr, nullptr};
+            auto new_node = new lru_node{key, std::move(value), ++_version, nullptr, nullptr};
             auto ptr = std::unique_ptr<lru_node>(new_node);
             _lru_head = std::move(ptr);
             _lru_tail = _lru_head.get();
@@ -90,7 +91,7 @@ bool SimpleLRU::_put_anyway(const std::string &key, const std::string &value) {
         while (_cur_size + ovr_size > _max_size) { // delete lru while there is not enough space
             delete_lru();
         }
-        auto new_node = new lru_node{key, value, nullptr, nullptr}; //inserting
+        auto new_node = new lru_node{key, std::move(value), ++_version, nullptr, nullptr}; //inserting
         auto ptr = std::unique_ptr<lru_node>(new_node);
         ptr->prev = _lru_tail;
         _lru_tail->next = std::move(ptr);
@@ -106,17 +107,22 @@ bool SimpleLRU::_put_anyway(const std::string &key, const std::string &value) {
 
 }
 
-// See MapBasedGlobalLockImpl.h
-bool SimpleLRU::Put(const std::string &key, const std::string &value) {
+bool SimpleLRU::_put(const std::string &key, std::string value) {
     auto search = _lru_index.find(key);
     if (search == _lru_index.end()) {
-        return _put_anyway(key, value);
+        return _put_anyway(key, std::move(value));
     } else {
         lru_node& node_found = search->second.get();
-        return _set_anyway(node_found, value);
+        return _set_anyway(node_found, std::move(value));
     }
 }
 
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Put(const std::string &key, const std::string &value) { return _put(key, value); }
+
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Put(const std::string &key, std::string &&value) { return _put(key, std::move(value)); }
+
 // See MapBasedGlobalLockImpl.h
 bool SimpleLRU::PutIfAbsent(const std::string &key, const std::string &value) {
     auto search = _lru_index.find(key);
@@ -138,6 +144,46 @@ bool SimpleLRU::Set(const std::string &key, const std::string &value) {
     return _set_anyway(node_found, value);
 }
 
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Update(const std::string &key, const std::function<bool(std::string &value)> &updater) {
+    // Qualified call, thread safe version holds its lock already
+    return SimpleLRU::Update(key, [&updater](std::string &value, uint64_t) { return updater(value); });
+}
+
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Update(const std::string &key,
+                       const std::function<bool(std::string &value, uint64_t version)> &updater) {
+    auto search = _lru_index.find(key);
+    if (search == _lru_index.end()) {
+        return false;
+    }
+
+    lru_node &node_found = search->second.get();
+    move_node_tail(node_found);
+
+    size_t old_size = node_found.value.size();
+    if (!updater(node_found.value, node_found.version)) {
+        return false;
+    }
+
+    size_t new_size = node_found.value.size();
+    if (key.size() + new_size > _max_size) {
+        // New value never fits, association can't be kept anymore
+        _lru_index.erase(key);
+        _cur_size -= key.size() + old_size;
+        delete_node(node_found);
+        return false;
+    }
+
+    // Node is in the tail, so it won't be evicted until there is something else in the list
+    node_found.version = ++_version;
+    _cur_size = _cur_size - old_size + new_size;
+    while (_cur_size > _max_size) {
+        delete_lru();
+    }
+    return true;
+}
+
 // See MapBasedGlobalLockImpl.h
 bool SimpleLRU::Delete(const std::string &key) {
     auto search = _lru_index.find(key);
@@ -155,12 +201,19 @@ bool SimpleLRU::Delete(const std::string &key) {
 
 // See MapBasedGlobalLockImpl.h
 bool SimpleLRU::Get(const std::string &key, std::string &value) {
+    uint64_t version;
+    return SimpleLRU::Get(key, value, version);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool SimpleLRU::Get(const std::string &key, std::string &value, uint64_t &version) {
     auto search = _lru_index.find(key);
     if (search == _lru_index.end()) {
         return false;
     }
     lru_node& node_found = search->second.get();
     value = node_found.value;
+    version = node_found.version;
 
     move_node_tail(node_found);
 
@@ -17,7 +17,7 @@ namespace Backend {
  */
 class SimpleLRU : public Afina::Storage {
 public:
-    explicit SimpleLRU(size_t max_size = 1024) : _max_size(max_size), _cur_size(0), _lru_head(nullptr), _lru_tail(nullptr) {}
+    explicit SimpleLRU(size_t max_size = 1024) : _max_size(max_size), _cur_size(0), _version(0), _lru_head(nullptr), _lru_tail(nullptr) {}
 
     ~SimpleLRU() override {
         _lru_index.clear();
@@ -33,34 +33,54 @@ public:
 
     }
 
+    // Implements Afina::Storage interface
+    std::size_t MaxValueSize() const override { return _max_size; }
+
     // Implements Afina::Storage interface
     bool Put(const std::string &key, const std::string &value) override;
 
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, std::string &&value) override;
+
     // Implements Afina::Storage interface
     bool PutIfAbsent(const std::string &key, const std::string &value) override;
 
     // Implements Afina::Storage interface
     bool Set(const std::string &key, const std::string &value) override;
 
+    // Implements Afina::Storage interface
+    bool Update(const std::string &key, const std::function<bool(std::string &value)> &updater) override;
+
+    // Implements Afina::Storage interface
+    bool Update(const std::string &key,
+                const std::function<bool(std::string &value, uint64_t version)> &updater) override;
+
     // Implements Afina::Storage interface
     bool Delete(const std::string &key) override;
 
     // Implements Afina::Storage interface
     bool Get(const std::string &key, std::string &value) override;
 
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value, uint64_t &version) override;
+
 private:
 
     // LRU cache node
     using lru_node = struct lru_node {
         const std::string key;
         std::string value;
+        uint64_t version;
         lru_node* prev;
         std::unique_ptr<lru_node> next;
     };
 
-    bool _put_anyway(const std::string &key, const std::string &value);
+    // Value is taken by value, so that callers could move buffer in rather than copy it
+    bool _put(const std::string &key, std::string value);
+
+    bool _put_anyway(const std::string &key, std::string value);
 
-    bool _set_anyway(lru_node& node_found, const std::string &value);
+    bool _set_anyway(lru_node& node_found, std::string value);
 
     void delete_lru();
 
@@ -73,6 +93,9 @@ private:
     std::size_t _max_size;
     std::size_t _cur_size;
 
+    // Version given to the value written last, see Storage::Get
+    uint64_t _version;
+
     // Main storage of lru_nodes, elements in this list ordered descending by "freshness": in the head
     // element that wasn't used for longest time.
     //
@@ -26,6 +26,12 @@ namespace Backend {
             return SimpleLRU::Put(key, value);
         }
 
+        // see SimpleLRU.h
+        bool Put(const std::string &key, std::string &&value) override {
+            std::unique_lock<std::mutex> lock(global_mutex);
+            return SimpleLRU::Put(key, std::move(value));
+        }
+
         // see SimpleLRU.h
         bool PutIfAbsent(const std::string &key, const std::string &value) override {
             std::unique_lock<std::mutex> lock(global_mutex);
@@ -38,6 +44,19 @@ namespace Backend {
             return SimpleLRU::Set(key, value);
         }
 
+        // see SimpleLRU.h
+        bool Update(const std::string &key, const std::function<bool(std::string &value)> &updater) override {
+            std::unique_lock<std::mutex> lock(global_mutex);
+            return SimpleLRU::Update(key, updater);
+        }
+
+        // see SimpleLRU.h
+        bool Update(const std::string &key,
+                    const std::function<bool(std::string &value, uint64_t version)> &updater) override {
+            std::unique_lock<std::mutex> lock(global_mutex);
+            return SimpleLRU::Update(key, updater);
+        }
+
         // see SimpleLRU.h
         bool Delete(const std::string &key) override {
             std::unique_lock<std::mutex> lock(global_mutex);
@@ -50,6 +69,12 @@ namespace Backend {
             return SimpleLRU::Get(key, value);
         }
 
+        // see SimpleLRU.h
+        bool Get(const std::string &key, std::string &value, uint64_t &version) override {
+            std::unique_lock<std::mutex> lock(global_mutex);
+            return SimpleLRU::Get(key, value, version);
+        }
+
     private:
         std::mutex global_mutex;
     };
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include <afina/coroutine/Engine.h>
 
@@ -62,3 +63,74 @@ TEST(CoroutineTest, Printer) {
     engine.start(_printer, engine, result);
     ASSERT_STREQ("A1 B1 A2 B2 A3 B3 END", result.c_str());
 }
+
+void _waiter(Afina::Coroutine::Engine &pe, std::stringstream &out) {
+    out << "W1 ";
+    pe.block();
+    out << "W2 ";
+}
+
+void _waker(Afina::Coroutine::Engine &pe, std::stringstream &out, void *&waiter) {
+    out << "K1 ";
+    pe.unblock(waiter);
+    pe.yield();
+    out << "K2 ";
+}
+
+// Routines stacks get overwritten by each other, so shared data must live elsewhere
+std::stringstream blocker_out;
+void _blocker(Afina::Coroutine::Engine &pe, std::string &result) {
+    std::stringstream &out = blocker_out;
+    void *waiter = pe.run(_waiter, pe, out);
+    pe.sched(waiter);
+
+    // Blocked routine doesn't get control until unblocked
+    pe.yield();
+    pe.sched(waiter);
+    out << "M1 ";
+
+    void *waker = pe.run(_waker, pe, out, waiter);
+    pe.sched(waker);
+    pe.yield();
+    pe.yield();
+
+    out << "END";
+    result = out.str();
+}
+
+TEST(CoroutineTest, BlockUnblock) {
+    Afina::Coroutine::Engine engine;
+
+    std::string result;
+    engine.start(_blocker, engine, result);
+    ASSERT_STREQ("W1 M1 K1 W2 K2 END", result.c_str());
+}
+
+void _sleeper(Afina::Coroutine::Engine &pe, int &woken) {
+    pe.block();
+    woken++;
+}
+
+void _sleepers(Afina::Coroutine::Engine &pe, std::vector<void *> &routines, int &woken) {
+    for (int i = 0; i < 3; i++) {
+        routines.push_back(pe.run(_sleeper, pe, woken));
+    }
+}
+
+TEST(CoroutineTest, Unblocker) {
+    std::vector<void *> routines;
+    int calls = 0, woken = 0;
+
+    // Engine asks to unblock routines once nobody else could run, one by one
+    Afina::Coroutine::Engine *pe = nullptr;
+    Afina::Coroutine::Engine engine([&] {
+        calls++;
+        pe->unblock(routines.back());
+        routines.pop_back();
+    });
+    pe = &engine;
+
+    engine.start(_sleepers, engine, routines, woken);
+    ASSERT_EQ(3, calls);
+    ASSERT_EQ(3, woken);
+}
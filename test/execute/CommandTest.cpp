@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+#include <afina/execute/Stats.h>
+
+#include "storage/SimpleLRU.h"
+
+using namespace Afina;
+
+// Runs single key command of the given type and returns its response
+static std::string RunCommand(Storage &storage, Execute::Command::Type type, const std::string &key, const std::string &args,
+                       uint64_t cas = 0) {
+    std::vector<std::string> keys = {key};
+    Execute::Command cmd;
+    cmd.Assign(type, keys, 1, 0, 0, cas);
+
+    Execute::Response out;
+    cmd.Execute(storage, args, out);
+    return out.Dump();
+}
+
+TEST(CommandTest, AppendPrepend) {
+    Backend::SimpleLRU storage;
+    ASSERT_EQ("NOT_STORED\r\n", RunCommand(storage, Execute::Command::Type::kAppend, "foo", "val"));
+    ASSERT_EQ("NOT_STORED\r\n", RunCommand(storage, Execute::Command::Type::kPrepend, "foo", "val"));
+
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kSet, "foo", "val"));
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kAppend, "foo", "_tail"));
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kPrepend, "foo", "head_"));
+
+    std::string value;
+    ASSERT_TRUE(storage.Get("foo", value));
+    ASSERT_EQ("head_val_tail", value);
+}
+
+TEST(CommandTest, Replace) {
+    Backend::SimpleLRU storage;
+    ASSERT_EQ("NOT_STORED\r\n", RunCommand(storage, Execute::Command::Type::kReplace, "foo", "val"));
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kAdd, "foo", "val"));
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kReplace, "foo", "new"));
+
+    std::string value;
+    ASSERT_TRUE(storage.Get("foo", value));
+    ASSERT_EQ("new", value);
+}
+
+TEST(CommandTest, GetsCas) {
+    Backend::SimpleLRU storage;
+    ASSERT_EQ("NOT_FOUND\r\n", RunCommand(storage, Execute::Command::Type::kCas, "foo", "val", 1));
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kSet, "foo", "val"));
+
+    std::string value;
+    uint64_t unique = 0;
+    ASSERT_TRUE(storage.Get("foo", value, unique));
+    ASSERT_EQ("VALUE foo 0 3 " + std::to_string(unique) + "\r\nval\r\nEND\r\n",
+              RunCommand(storage, Execute::Command::Type::kGets, "foo", ""));
+
+    ASSERT_EQ("EXISTS\r\n", RunCommand(storage, Execute::Command::Type::kCas, "foo", "new", unique + 1));
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kCas, "foo", "new", unique));
+
+    // Value has been changed, so old unique value isn't valid anymore
+    ASSERT_EQ("EXISTS\r\n", RunCommand(storage, Execute::Command::Type::kCas, "foo", "other", unique));
+
+    // Nor it is once value got its old data back
+    ASSERT_TRUE(storage.Get("foo", value, unique));
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kSet, "foo", "tmp"));
+    ASSERT_EQ("STORED\r\n", RunCommand(storage, Execute::Command::Type::kSet, "foo", "new"));
+    ASSERT_EQ("EXISTS\r\n", RunCommand(storage, Execute::Command::Type::kCas, "foo", "other", unique));
+}
+
+TEST(CommandTest, StatsCounters) {
+    Backend::SimpleLRU storage;
+    std::atomic<int64_t> &counter = Execute::Stats::Counter("test_counter");
+    counter.fetch_add(42);
+    ASSERT_EQ(&counter, &Execute::Stats::Counter("test_counter"));
+
+    std::string out = RunCommand(storage, Execute::Command::Type::kStats, "", "");
+    ASSERT_NE(std::string::npos, out.find("STAT test_counter 42\r\n"));
+    ASSERT_EQ("END\r\n", out.substr(out.size() - 5));
+}
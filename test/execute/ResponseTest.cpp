@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include "storage/SimpleLRU.h"
+
+using namespace Afina;
+
+// Collects data described by iovec into a string
+static std::string Gather(struct iovec *iov, size_t n) {
+    std::string result;
+    for (size_t i = 0; i < n; i++) {
+        result.append(static_cast<char *>(iov[i].iov_base), iov[i].iov_len);
+    }
+    return result;
+}
+
+TEST(ResponseTest, AppendNumber) {
+    Execute::Response out;
+    out.AppendNumber(0);
+    out.Append(" ");
+    out.AppendNumber(42);
+    out.Append(" ");
+    out.AppendNumber(18446744073709551615ull);
+    ASSERT_EQ("0 42 18446744073709551615", out.Dump());
+}
+
+TEST(ResponseTest, ValueSegments) {
+    Execute::Response out;
+    out.Append("VALUE a 0 3\r\n");
+    out.ValueBuffer().assign("foo");
+    out.CommitValue();
+    out.Append("\r\n");
+
+    // Not committed value isn't a part of response
+    out.ValueBuffer().assign("bar");
+    out.Append("END\r\n");
+
+    struct iovec iov[8];
+    size_t n = out.Prepare(iov, 8);
+    ASSERT_EQ(3, n);
+    ASSERT_EQ("VALUE a 0 3\r\nfoo\r\nEND\r\n", Gather(iov, n));
+    ASSERT_EQ(out.Dump().size(), out.Size());
+}
+
+TEST(ResponseTest, PartialConsume) {
+    Execute::Response out;
+    out.Append("VALUE a 0 6\r\n");
+    out.ValueBuffer().assign("foobar");
+    out.CommitValue();
+    out.Append("\r\nEND\r\n");
+
+    std::string expected = out.Dump();
+    std::string sent;
+    while (!out.Empty()) {
+        struct iovec iov[8];
+        size_t n = out.Prepare(iov, 8);
+        std::string chunk = Gather(iov, n).substr(0, 4);
+        sent += chunk;
+        out.Consume(chunk.size());
+    }
+    ASSERT_EQ(expected, sent);
+    ASSERT_EQ(0, out.Size());
+}
+
+TEST(ResponseTest, PrepareOffset) {
+    Execute::Response out;
+    out.Append("VALUE a 0 6\r\n");
+    out.ValueBuffer().assign("foobar");
+    out.CommitValue();
+    out.Append("\r\nEND\r\n");
+
+    std::string expected = out.Dump();
+    for (size_t offset = 0; offset < expected.size(); offset++) {
+        struct iovec iov[8];
+        size_t n = out.Prepare(iov, 8, offset);
+        ASSERT_EQ(expected.substr(offset), Gather(iov, n));
+    }
+
+    struct iovec iov[8];
+    ASSERT_EQ(0, out.Prepare(iov, 8, expected.size()));
+    ASSERT_EQ(expected, out.Dump());
+}
+
+TEST(ResponseTest, CompactKeepsOrder) {
+    Execute::Response out;
+    std::string expected;
+    for (int i = 0; i < 500; i++) {
+        std::string value = "value" + std::to_string(i);
+        out.Append("V ");
+        out.ValueBuffer().assign(value);
+        out.CommitValue();
+        expected += "V " + value;
+
+        // Send a bit less than was appended so that response never gets empty
+        struct iovec iov[4];
+        size_t n = out.Prepare(iov, 4);
+        std::string chunk = Gather(iov, n);
+        size_t to_send = std::min(chunk.size(), size_t(5));
+        expected.erase(0, to_send);
+        out.Consume(to_send);
+        ASSERT_EQ(expected, out.Dump());
+    }
+}
+
+TEST(ResponseTest, Swap) {
+    Execute::Response sending, output;
+    sending.Append("STORED\r\n");
+    output.Append("VALUE a 0 3\r\n");
+    output.ValueBuffer().assign("foo");
+    output.CommitValue();
+    output.Append("\r\nEND\r\n");
+
+    sending.Consume(sending.Size());
+    sending.Swap(output);
+    ASSERT_TRUE(output.Empty());
+    ASSERT_EQ("VALUE a 0 3\r\nfoo\r\nEND\r\n", sending.Dump());
+
+    output.Append("DELETED\r\n");
+    ASSERT_EQ("DELETED\r\n", output.Dump());
+}
+
+TEST(ResponseTest, Splice) {
+    Execute::Response output, offloaded;
+    output.Append("STORED\r\n");
+    offloaded.Append("VALUE a 0 3\r\n");
+    offloaded.ValueBuffer().assign("foo");
+    offloaded.CommitValue();
+    offloaded.Append("\r\nEND\r\n");
+
+    output.Splice(offloaded);
+    ASSERT_TRUE(offloaded.Empty());
+    ASSERT_EQ("STORED\r\nVALUE a 0 3\r\nfoo\r\nEND\r\n", output.Dump());
+    ASSERT_EQ(output.Dump().size(), output.Size());
+
+    // Into empty response content is just exchanged
+    Execute::Response empty;
+    empty.Splice(output);
+    ASSERT_TRUE(output.Empty());
+    ASSERT_EQ("STORED\r\nVALUE a 0 3\r\nfoo\r\nEND\r\n", empty.Dump());
+}
+
+TEST(ResponseTest, GetResponse) {
+    Backend::SimpleLRU storage;
+    storage.Put("foo", "fooval");
+    storage.Put("bar", "");
+
+    std::vector<std::string> keys = {"foo", "none", "bar"};
+    Execute::Command cmd;
+    cmd.Assign(Execute::Command::Type::kGet, keys, 3, 0, 0);
+
+    Execute::Response out;
+    cmd.Execute(storage, "", out);
+    ASSERT_EQ("VALUE foo 0 6\r\nfooval\r\nVALUE bar 0 0\r\n\r\nEND\r\n", out.Dump());
+}
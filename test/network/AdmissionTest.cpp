@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <vector>
+
+#include "network/Admission.h"
+
+using namespace Afina::Network;
+
+using clock_type = Admission::clock;
+using std::chrono::milliseconds;
+
+// Target of 5ms, interval of 100ms
+static const std::size_t TARGET_US = 5000;
+static const std::size_t INTERVAL_MS = 100;
+
+// Zero time point means "never" for Admission, so synthetic clock starts elsewhere
+static const clock_type::time_point START = clock_type::time_point() + std::chrono::hours(1);
+
+/**
+ * Runs worker rounds one per millisecond from the given moment for the given number of milliseconds: round
+ * which isn't shed reports delay, shed one takes next to nothing. Returns moments of shed rounds in
+ * milliseconds since START
+ */
+static std::vector<long> Rounds(Admission &admission, clock_type::time_point &now, long duration, milliseconds delay) {
+    std::vector<long> shed_at;
+    for (long i = 0; i < duration; i++) {
+        bool shed = admission.Shed(now);
+        if (shed) {
+            shed_at.push_back(std::chrono::duration_cast<milliseconds>(now - START).count());
+        }
+        admission.Observe(shed ? clock_type::duration(0) : clock_type::duration(delay), now, shed);
+        now += milliseconds(1);
+    }
+    return shed_at;
+}
+
+TEST(AdmissionTest, Disabled) {
+    Admission admission(0, INTERVAL_MS);
+    EXPECT_FALSE(admission.Enabled());
+}
+
+TEST(AdmissionTest, BurstIsFine) {
+    Admission admission(TARGET_US, INTERVAL_MS);
+    EXPECT_TRUE(admission.Enabled());
+
+    // Delay goes above target, but drops back before interval is over
+    clock_type::time_point now = START;
+    EXPECT_TRUE(Rounds(admission, now, INTERVAL_MS - 10, milliseconds(20)).empty());
+    EXPECT_TRUE(Rounds(admission, now, 10, milliseconds(1)).empty());
+    EXPECT_TRUE(Rounds(admission, now, INTERVAL_MS - 10, milliseconds(20)).empty());
+}
+
+TEST(AdmissionTest, StartsAfterInterval) {
+    Admission admission(TARGET_US, INTERVAL_MS);
+
+    clock_type::time_point now = START;
+    std::vector<long> shed_at = Rounds(admission, now, 2000, milliseconds(20));
+    ASSERT_GT(shed_at.size(), 3);
+
+    // Delay must stay above target for the whole interval first, then the very next round is shed
+    EXPECT_GE(shed_at[0], long(INTERVAL_MS));
+    EXPECT_LE(shed_at[0], long(INTERVAL_MS) + 2);
+}
+
+TEST(AdmissionTest, ShedsMoreOften) {
+    Admission admission(TARGET_US, INTERVAL_MS);
+
+    clock_type::time_point now = START;
+    std::vector<long> shed_at = Rounds(admission, now, 2000, milliseconds(20));
+    ASSERT_GT(shed_at.size(), 3);
+
+    // Gaps follow interval / sqrt(n), rounded to the 1ms rounds
+    std::vector<long> gaps;
+    for (std::size_t i = 1; i < shed_at.size(); i++) {
+        gaps.push_back(shed_at[i] - shed_at[i - 1]);
+    }
+    EXPECT_NEAR(long(INTERVAL_MS), gaps.front(), 1);
+    for (std::size_t i = 1; i < gaps.size(); i++) {
+        EXPECT_LE(gaps[i], gaps[i - 1] + 1) << "gap " << i;
+    }
+    EXPECT_LT(gaps.back() * 3, gaps.front());
+}
+
+TEST(AdmissionTest, StopsBelowTarget) {
+    Admission admission(TARGET_US, INTERVAL_MS);
+
+    clock_type::time_point now = START;
+    ASSERT_FALSE(Rounds(admission, now, 500, milliseconds(20)).empty());
+
+    // First round which isn't shed reports low delay and ends shedding
+    EXPECT_LE(Rounds(admission, now, INTERVAL_MS, milliseconds(1)).size(), 1);
+    EXPECT_TRUE(Rounds(admission, now, 1000, milliseconds(1)).empty());
+
+    // Shedding starts over only after another whole interval above target
+    std::vector<long> shed_at = Rounds(admission, now, 2 * INTERVAL_MS, milliseconds(20));
+    ASSERT_FALSE(shed_at.empty());
+    EXPECT_GE(shed_at[0], 500 + 1100 + long(INTERVAL_MS));
+}
+
+TEST(AdmissionTest, StopsWhenIdle) {
+    Admission admission(TARGET_US, INTERVAL_MS);
+
+    clock_type::time_point now = START;
+    ASSERT_FALSE(Rounds(admission, now, 500, milliseconds(20)).empty());
+
+    // Worker had nothing to do for an interval, whatever was queued is gone
+    now += milliseconds(INTERVAL_MS);
+    EXPECT_FALSE(admission.Shed(now));
+}
@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+#include <afina/execute/Stats.h>
+
+#include "network/BufferPool.h"
+#include "network/CommandStream.h"
+#include "storage/SimpleLRU.h"
+
+using namespace Afina::Network;
+
+static const std::size_t CHUNK_SIZE = BufferPool::CHUNK_SIZE;
+
+static int64_t UsedBytes() { return Afina::Execute::Stats::Counter("read_buffers_used_bytes").load(); }
+
+static int64_t AllocatedBytes() { return Afina::Execute::Stats::Counter("read_buffers_bytes").load(); }
+
+// Appends bytes the way connection reads them from socket: into space of the tail chunk, as much as fits
+static void Fill(ReadBuffer &buffer, const std::string &input) {
+    std::size_t offset = 0;
+    while (offset < input.size()) {
+        std::size_t space = 0;
+        char *p = buffer.Space(space);
+        ASSERT_GT(space, 0);
+
+        std::size_t bytes = std::min(space, input.size() - offset);
+        std::memcpy(p, input.data() + offset, bytes);
+        buffer.Commit(bytes);
+        offset += bytes;
+    }
+}
+
+TEST(BufferPoolTest, EmptyRead) {
+    ReadBuffer buffer;
+    std::size_t space = 0;
+    ASSERT_NE(nullptr, buffer.Space(space));
+    EXPECT_EQ(CHUNK_SIZE, space);
+    EXPECT_EQ(int64_t(sizeof(BufferPool::Chunk)), UsedBytes());
+
+    // Nothing has been read, so the chunk goes back right away
+    buffer.Commit(0);
+    EXPECT_TRUE(buffer.Empty());
+    EXPECT_EQ(0, UsedBytes());
+
+    std::size_t size = 1;
+    EXPECT_EQ(nullptr, buffer.Data(size));
+    EXPECT_EQ(0, size);
+}
+
+TEST(BufferPoolTest, DataIsHeadChunk) {
+    ReadBuffer buffer;
+    Fill(buffer, std::string(CHUNK_SIZE - 10, 'a') + std::string(30, 'b'));
+    EXPECT_EQ(CHUNK_SIZE + 20, buffer.Size());
+    EXPECT_EQ(int64_t(2 * sizeof(BufferPool::Chunk)), UsedBytes());
+
+    // Only head chunk is contiguous, the rest comes once it is consumed
+    std::size_t size = 0;
+    const char *data = buffer.Data(size);
+    ASSERT_EQ(CHUNK_SIZE, size);
+    EXPECT_EQ('a', data[0]);
+    EXPECT_EQ('b', data[size - 1]);
+
+    buffer.Consume(CHUNK_SIZE - 5);
+    data = buffer.Data(size);
+    ASSERT_EQ(5, size);
+    EXPECT_EQ(std::string(5, 'b'), std::string(data, size));
+
+    // Drained head chunk goes back to pool
+    buffer.Consume(5);
+    EXPECT_EQ(int64_t(sizeof(BufferPool::Chunk)), UsedBytes());
+    data = buffer.Data(size);
+    ASSERT_EQ(20, size);
+    EXPECT_EQ(std::string(20, 'b'), std::string(data, size));
+}
+
+TEST(BufferPoolTest, Drain) {
+    ReadBuffer buffer;
+    Fill(buffer, std::string(3 * CHUNK_SIZE, 'a'));
+    EXPECT_EQ(int64_t(3 * sizeof(BufferPool::Chunk)), UsedBytes());
+
+    while (!buffer.Empty()) {
+        std::size_t size = 0;
+        buffer.Data(size);
+        buffer.Consume(std::min(size, std::size_t(1000)));
+    }
+    EXPECT_EQ(0, buffer.Size());
+    EXPECT_EQ(0, UsedBytes());
+
+    // Buffer could be used again once drained
+    Fill(buffer, "get foo\r\n");
+    EXPECT_EQ(9, buffer.Size());
+    buffer.Clear();
+    EXPECT_EQ(0, UsedBytes());
+}
+
+TEST(BufferPoolTest, CommandAcrossChunks) {
+    Afina::Backend::SimpleLRU storage(1024);
+    CommandStream stream(storage);
+    Afina::Execute::Response output;
+    std::string executed;
+    auto execute = [&executed](Afina::Execute::Command &, std::string &args, Afina::Execute::Response &) {
+        executed.append(args);
+        executed.append(";");
+    };
+
+    // Command line of the last set is split by the chunk boundary, its data block is in the next chunk
+    std::string request = "set foo 0 0 3\r\nbar\r\n";
+    std::string input;
+    while (input.size() + request.size() < CHUNK_SIZE) {
+        input.append(request);
+    }
+    std::size_t commands = input.size() / request.size();
+    ASSERT_LT(CHUNK_SIZE - input.size(), std::string("set foobar 0 0 6\r\n").size());
+    input.append("set foobar 0 0 6\r\nfoobar\r\n");
+
+    ReadBuffer buffer;
+    Fill(buffer, input);
+
+    // The same way connection processes its input
+    while (!buffer.Empty()) {
+        std::size_t size = 0;
+        const char *data = buffer.Data(size);
+        std::size_t consumed = stream.Process(data, size, output, execute);
+        buffer.Consume(consumed);
+        if (consumed < size) {
+            break;
+        }
+    }
+
+    std::string expected;
+    for (std::size_t i = 0; i < commands; i++) {
+        expected.append("bar;");
+    }
+    expected.append("foobar;");
+    EXPECT_EQ(expected, executed);
+    EXPECT_TRUE(buffer.Empty());
+    EXPECT_FALSE(stream.Started());
+    EXPECT_EQ(0, UsedBytes());
+}
+
+TEST(BufferPoolTest, OtherThreadPool) {
+    ReadBuffer buffer;
+    Fill(buffer, std::string(2 * CHUNK_SIZE, 'a'));
+    int64_t allocated = AllocatedBytes();
+
+    // Connection moved to other worker gives its chunks to pool of that thread, which frees them on exit
+    std::thread worker([&buffer]() { buffer.Clear(); });
+    worker.join();
+
+    EXPECT_TRUE(buffer.Empty());
+    EXPECT_EQ(0, UsedBytes());
+    EXPECT_EQ(allocated - int64_t(2 * sizeof(BufferPool::Chunk)), AllocatedBytes());
+}
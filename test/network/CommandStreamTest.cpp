@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include "network/CommandStream.h"
+#include "storage/SimpleLRU.h"
+
+using namespace Afina::Network;
+
+// Drains response into string
+static std::string Take(Afina::Execute::Response &output) {
+    std::string result;
+    struct iovec iov[16];
+    while (!output.Empty()) {
+        std::size_t bytes = 0, cnt = output.Prepare(iov, 16);
+        for (std::size_t i = 0; i < cnt; i++) {
+            result.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+            bytes += iov[i].iov_len;
+        }
+        output.Consume(bytes);
+    }
+    return result;
+}
+
+static auto execute = [](Afina::Execute::Command &command, std::string &args, Afina::Execute::Response &output) {
+    output.Append("EXEC " + args + "\r\n");
+};
+
+TEST(CommandStreamTest, SplitInput) {
+    Afina::Backend::SimpleLRU storage(1024);
+    CommandStream stream(storage);
+    Afina::Execute::Response output;
+
+    std::string input = "set foo 0 0 3\r\nbar\r\nget foo\r\n";
+    for (char c : input) {
+        EXPECT_EQ(1, stream.Process(&c, 1, output, execute));
+    }
+    EXPECT_EQ("EXEC bar\r\nEXEC \r\n", Take(output));
+    EXPECT_FALSE(stream.Started());
+}
+
+TEST(CommandStreamTest, BadDataChunk) {
+    Afina::Backend::SimpleLRU storage(1024);
+    CommandStream stream(storage);
+    Afina::Execute::Response output;
+
+    std::string input = "set foo 0 0 3\r\nbarXXget foo\r\n";
+    EXPECT_EQ(input.size(), stream.Process(input.data(), input.size(), output, execute));
+    EXPECT_EQ("CLIENT_ERROR bad data chunk\r\nEXEC \r\n", Take(output));
+}
+
+TEST(CommandStreamTest, Stop) {
+    Afina::Backend::SimpleLRU storage(1024);
+    CommandStream stream(storage);
+    Afina::Execute::Response output;
+
+    int allowed = 1;
+    auto more = [&allowed]() { return allowed-- > 0; };
+    std::string input = "get a\r\nget b\r\n";
+    EXPECT_EQ(7, stream.Process(input.data(), input.size(), output, execute, more));
+    EXPECT_EQ("EXEC \r\n", Take(output));
+}
+
+TEST(CommandStreamTest, TooLarge) {
+    Afina::Backend::SimpleLRU storage(1024);
+    CommandStream stream(storage);
+    Afina::Execute::Response output;
+
+    // Data block is skipped rather than stored, stream goes on with the next command
+    std::string input = "set foo 0 0 4000000000\r\n";
+    EXPECT_EQ(input.size(), stream.Process(input.data(), input.size(), output, execute));
+    EXPECT_EQ(4000000002, stream.Remains());
+
+    std::string block(1000000, 'x');
+    while (stream.Remains() > block.size()) {
+        EXPECT_EQ(block.size(), stream.Process(block.data(), block.size(), output, execute));
+        ssize_t bytes = stream.ReadArgument([](char *into, std::size_t room) {
+            std::memset(into, 'x', room);
+            return ssize_t(room);
+        });
+        EXPECT_GT(bytes, 0);
+    }
+    EXPECT_TRUE(Take(output).empty());
+
+    input = std::string(stream.Remains() - 2, 'x') + "\r\nget foo\r\n";
+    EXPECT_EQ(input.size(), stream.Process(input.data(), input.size(), output, execute));
+    EXPECT_EQ("SERVER_ERROR object too large for cache\r\nEXEC \r\n", Take(output));
+}
+
+TEST(CommandStreamTest, ReadArgument) {
+    Afina::Backend::SimpleLRU storage(16 * 1024 * 1024);
+    CommandStream stream(storage);
+    Afina::Execute::Response output;
+
+    std::string input = "set foo 0 0 3000000\r\nyy";
+    EXPECT_EQ(input.size(), stream.Process(input.data(), input.size(), output, execute));
+
+    // Memory is taken as data arrives, not as much as command announces
+    while (stream.Remains() > 2) {
+        std::size_t remains = stream.Remains();
+        ssize_t bytes = stream.ReadArgument([remains](char *into, std::size_t room) {
+            EXPECT_LE(room, 64 * 1024);
+            EXPECT_LE(room, remains);
+            std::memset(into, 'y', std::min(room, remains - 2));
+            return ssize_t(std::min(room, remains - 2));
+        });
+        EXPECT_GT(bytes, 0);
+    }
+
+    std::size_t size = 0;
+    input = "\r\n";
+    EXPECT_EQ(2, stream.Process(input.data(), input.size(), output,
+                                [&size](Afina::Execute::Command &, std::string &args, Afina::Execute::Response &) {
+                                    size = args.size();
+                                    EXPECT_EQ(std::string(size, 'y'), args);
+                                }));
+    EXPECT_EQ(3000000, size);
+}
@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "network/TimerWheel.h"
+
+using namespace Afina::Network;
+
+// Timeout of 16 ticks, 100ms each
+static const std::size_t TIMEOUT = 1600;
+
+TEST(TimerWheelTest, Disabled) {
+    TimerWheel wheel(0);
+    EXPECT_FALSE(wheel.Enabled());
+
+    int owner;
+    TimerWheel::Entry entry(&owner);
+    wheel.Add(&entry);
+    EXPECT_EQ(0, wheel.Size());
+    EXPECT_EQ(-1, wheel.Timeout());
+
+    std::vector<TimerWheel::Entry *> expired;
+    wheel.Update(TimerWheel::Now() + 1000000);
+    wheel.Expire(expired);
+    EXPECT_TRUE(expired.empty());
+}
+
+TEST(TimerWheelTest, Add) {
+    uint64_t start = TimerWheel::Now();
+    TimerWheel wheel(TIMEOUT);
+    EXPECT_TRUE(wheel.Enabled());
+
+    int owner;
+    TimerWheel::Entry entry(&owner);
+    wheel.Update(start);
+    wheel.Add(&entry);
+    EXPECT_EQ(1, wheel.Size());
+
+    std::vector<TimerWheel::Entry *> expired;
+    wheel.Update(start + TIMEOUT);
+    wheel.Expire(expired);
+    EXPECT_TRUE(expired.empty());
+    EXPECT_EQ(1, wheel.Size());
+
+    // Activity could happen at the very end of the tick, so up to a tick more is allowed
+    wheel.Update(start + TIMEOUT + 200);
+    wheel.Expire(expired);
+    ASSERT_EQ(1, expired.size());
+    EXPECT_EQ(&entry, expired[0]);
+    EXPECT_EQ(&owner, expired[0]->owner);
+    EXPECT_EQ(0, wheel.Size());
+    EXPECT_EQ(TimerWheel::NO_SLOT, entry.slot);
+}
+
+TEST(TimerWheelTest, Touch) {
+    uint64_t start = TimerWheel::Now();
+    TimerWheel wheel(TIMEOUT);
+
+    int owner;
+    TimerWheel::Entry first(&owner), second(&owner);
+    wheel.Update(start);
+    wheel.Add(&first);
+    wheel.Add(&second);
+
+    // One is touched at wheel time, the other one at time given explicitly
+    wheel.Update(start + 1000);
+    wheel.Touch(&first);
+    wheel.Touch(&second, start + 1500);
+
+    std::vector<TimerWheel::Entry *> expired;
+    wheel.Update(start + TIMEOUT + 200);
+    wheel.Expire(expired);
+    EXPECT_TRUE(expired.empty());
+    EXPECT_EQ(2, wheel.Size());
+
+    wheel.Update(start + 1000 + TIMEOUT + 200);
+    wheel.Expire(expired);
+    ASSERT_EQ(1, expired.size());
+    EXPECT_EQ(&first, expired[0]);
+
+    expired.clear();
+    wheel.Update(start + 1500 + TIMEOUT + 200);
+    wheel.Expire(expired);
+    ASSERT_EQ(1, expired.size());
+    EXPECT_EQ(&second, expired[0]);
+    EXPECT_EQ(0, wheel.Size());
+}
+
+TEST(TimerWheelTest, Remove) {
+    uint64_t start = TimerWheel::Now();
+    TimerWheel wheel(TIMEOUT);
+
+    int owner;
+    TimerWheel::Entry first(&owner), second(&owner), third(&owner);
+    wheel.Update(start);
+    wheel.Add(&first);
+    wheel.Add(&second);
+    wheel.Add(&third);
+
+    // Entries share the slot, so removal from the middle of list is covered as well
+    wheel.Remove(&second);
+    EXPECT_EQ(2, wheel.Size());
+    EXPECT_EQ(TimerWheel::NO_SLOT, second.slot);
+    wheel.Remove(&second);
+    EXPECT_EQ(2, wheel.Size());
+
+    wheel.Remove(&third);
+    EXPECT_EQ(1, wheel.Size());
+
+    std::vector<TimerWheel::Entry *> expired;
+    wheel.Update(start + TIMEOUT + 200);
+    wheel.Expire(expired);
+    ASSERT_EQ(1, expired.size());
+    EXPECT_EQ(&first, expired[0]);
+}
+
+TEST(TimerWheelTest, Expire) {
+    uint64_t start = TimerWheel::Now();
+    TimerWheel wheel(TIMEOUT);
+
+    int owner;
+    std::deque<TimerWheel::Entry> entries;
+    for (std::size_t i = 0; i < 10; i++) {
+        entries.emplace_back(&owner);
+        wheel.Update(start + i * 100);
+        wheel.Add(&entries.back());
+    }
+
+    // Entries expire in the order they were added, a few ticks at a time
+    std::vector<TimerWheel::Entry *> expired;
+    std::size_t total = 0;
+    for (uint64_t now = start + 1000; now <= start + 10 * 100 + TIMEOUT + 200; now += 300) {
+        wheel.Update(now);
+        wheel.Expire(expired);
+        for (TimerWheel::Entry *entry : expired) {
+            EXPECT_EQ(&entries[total], entry);
+            total++;
+        }
+        expired.clear();
+    }
+    EXPECT_EQ(entries.size(), total);
+    EXPECT_EQ(0, wheel.Size());
+
+    // Wheel which hasn't been moved for many revolutions still expires everything once
+    TimerWheel::Entry entry(&owner);
+    wheel.Add(&entry);
+    wheel.Update(start + 1000000);
+    wheel.Expire(expired);
+    ASSERT_EQ(1, expired.size());
+    EXPECT_EQ(&entry, expired[0]);
+}
+
+TEST(TimerWheelTest, Timeout) {
+    uint64_t start = TimerWheel::Now();
+    TimerWheel wheel(TIMEOUT);
+    EXPECT_EQ(-1, wheel.Timeout(start));
+
+    int owner;
+    TimerWheel::Entry entry(&owner);
+    wheel.Update(start);
+    wheel.Add(&entry);
+
+    int timeout = wheel.Timeout(start);
+    EXPECT_GT(timeout, int(TIMEOUT));
+    EXPECT_LE(timeout, int(TIMEOUT + 100));
+    EXPECT_EQ(timeout - 500, wheel.Timeout(start + 500));
+    EXPECT_EQ(0, wheel.Timeout(start + TIMEOUT + 200));
+
+    wheel.Remove(&entry);
+    EXPECT_EQ(-1, wheel.Timeout(start));
+}
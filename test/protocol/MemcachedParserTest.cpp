@@ -1,19 +1,15 @@
 #include <gtest/gtest.h>
 
-#include <memory>
 #include <string>
+#include <vector>
 
-#include <afina/execute/Add.h>
-#include <afina/execute/Get.h>
-#include <afina/execute/Set.h>
-#include <afina/execute/Stats.h>
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
 
 #include <protocol/Parser.h>
 
 using namespace Afina;
 
-// TODO: Negative test on errors
-// TODO: Separate tests for integers overflow
 // TODO: Special test that consumed only increased
 
 // Verify simple set command passed in a single string
@@ -24,17 +20,17 @@ TEST(MemcachedParserTest, SimpleSet) {
     bool cmd_avail = parser.Parse("set foo 0 0 6\r\nfooval\r\n", consumed);
     ASSERT_TRUE(cmd_avail);
     ASSERT_EQ(15, consumed);
-    ASSERT_EQ("set", parser.Name());
+    ASSERT_STREQ("set", parser.Name());
 
     size_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
-    ASSERT_FALSE(cmd == nullptr);
+    Execute::Command cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd));
     ASSERT_EQ(6, value_size);
 
-    Execute::Set *tmp = reinterpret_cast<Execute::Set *>(cmd.get());
-    ASSERT_EQ("foo", tmp->key());
-    ASSERT_EQ(0, tmp->flags());
-    ASSERT_EQ(0, tmp->expire());
+    ASSERT_EQ(Execute::Command::Type::kSet, cmd.type());
+    ASSERT_EQ("foo", cmd.key());
+    ASSERT_EQ(0, cmd.flags());
+    ASSERT_EQ(0, cmd.expire());
 }
 
 // Verify simple add command passed in a single string
@@ -45,17 +41,17 @@ TEST(MemcachedParserTest, SimpleAdd) {
     bool cmd_avail = parser.Parse("add bar 10 -1 60\r\nbarval\r\n", consumed);
     ASSERT_TRUE(cmd_avail);
     ASSERT_EQ(18, consumed);
-    ASSERT_EQ("add", parser.Name());
+    ASSERT_STREQ("add", parser.Name());
 
     size_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
-    ASSERT_FALSE(cmd == nullptr);
+    Execute::Command cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd));
     ASSERT_EQ(60, value_size);
 
-    Execute::Add *tmp = reinterpret_cast<Execute::Add *>(cmd.get());
-    ASSERT_EQ("bar", tmp->key());
-    ASSERT_EQ(10, tmp->flags());
-    ASSERT_EQ(-1, tmp->expire());
+    ASSERT_EQ(Execute::Command::Type::kAdd, cmd.type());
+    ASSERT_EQ("bar", cmd.key());
+    ASSERT_EQ(10, cmd.flags());
+    ASSERT_EQ(-1, cmd.expire());
 }
 
 // Verify simple get command passed in a single string
@@ -66,19 +62,18 @@ TEST(MemcachedParserTest, SimpleGet) {
     bool cmd_avail = parser.Parse("get ke key2 super_long_key\r\n", consumed);
     ASSERT_TRUE(cmd_avail);
     ASSERT_EQ(28, consumed);
-    ASSERT_EQ("get", parser.Name());
+    ASSERT_STREQ("get", parser.Name());
 
     size_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
-    ASSERT_FALSE(cmd == nullptr);
+    Execute::Command cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd));
     ASSERT_EQ(0, value_size);
 
-    Execute::Get *tmp = reinterpret_cast<Execute::Get *>(cmd.get());
-    std::vector<std::string> keys = tmp->keys();
-    ASSERT_EQ(3, keys.size());
-    ASSERT_EQ("ke", keys[0]);
-    ASSERT_EQ("key2", keys[1]);
-    ASSERT_EQ("super_long_key", keys[2]);
+    ASSERT_EQ(Execute::Command::Type::kGet, cmd.type());
+    ASSERT_EQ(3, cmd.nkeys());
+    ASSERT_EQ("ke", cmd.key(0));
+    ASSERT_EQ("key2", cmd.key(1));
+    ASSERT_EQ("super_long_key", cmd.key(2));
 }
 
 TEST(MemcachedParserTest, Stats) {
@@ -88,13 +83,159 @@ TEST(MemcachedParserTest, Stats) {
     bool cmd_avail = parser.Parse("stats\r\n", consumed);
     ASSERT_TRUE(cmd_avail);
     ASSERT_EQ(7, consumed);
-    ASSERT_EQ("stats", parser.Name());
+    ASSERT_STREQ("stats", parser.Name());
 
     size_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
-    ASSERT_FALSE(cmd == nullptr);
+    Execute::Command cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd));
     ASSERT_EQ(0, value_size);
 
-    Execute::Stats *tmp = reinterpret_cast<Execute::Stats *>(cmd.get());
-    ASSERT_FALSE(tmp == nullptr);
+    ASSERT_EQ(Execute::Command::Type::kStats, cmd.type());
+}
+
+// Verify unknown command is reported without exception and parser resyncs on the next line
+TEST(MemcachedParserTest, UnknownCommand) {
+    Protocol::Parser parser;
+
+    std::string input = "foo bar baz\r\nget key\r\n";
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse(input, consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(13, consumed);
+    ASSERT_TRUE(parser.Failed());
+    ASSERT_EQ(Protocol::Parser::Error::kUnknownCommand, parser.GetError());
+
+    size_t value_size;
+    Execute::Command cmd;
+    ASSERT_FALSE(parser.Build(value_size, cmd));
+    ASSERT_FALSE(cmd);
+
+    Execute::Response out;
+    parser.BuildError(out);
+    ASSERT_EQ("ERROR\r\n", out.Dump());
+
+    parser.Reset();
+    cmd_avail = parser.Parse(input.substr(consumed), consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_FALSE(parser.Failed());
+    ASSERT_STREQ("get", parser.Name());
+}
+
+// Verify malformed numeric fields are reported as client errors
+TEST(MemcachedParserTest, BadFormat) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse("set foo x 0 6\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(15, consumed);
+    ASSERT_EQ(Protocol::Parser::Error::kBadFormat, parser.GetError());
+
+    Execute::Response out;
+    parser.BuildError(out);
+    ASSERT_EQ("CLIENT_ERROR bad command line format\r\n", out.Dump());
+}
+
+// Verify integer overflow doesn't throw and whole line is skipped
+TEST(MemcachedParserTest, Overflow) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse("set foo 0 0 99999999999\r\nfooval\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(25, consumed);
+    ASSERT_EQ(Protocol::Parser::Error::kOverflow, parser.GetError());
+
+    parser.Reset();
+    cmd_avail = parser.Parse("add bar 4294967296 0 6\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(Protocol::Parser::Error::kOverflow, parser.GetError());
+}
+
+// Verify line which ends in the middle of the command is reported once \n arrives
+TEST(MemcachedParserTest, TruncatedLine) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    ASSERT_FALSE(parser.Started());
+    ASSERT_FALSE(parser.Parse("set foo", consumed));
+    ASSERT_EQ(7, consumed);
+    ASSERT_FALSE(parser.Failed());
+    ASSERT_TRUE(parser.Started());
+
+    bool cmd_avail = parser.Parse("\nget foo\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(1, consumed);
+    ASSERT_TRUE(parser.Failed());
+}
+
+// Verify command instance is reused between requests and keeps nothing from the previous one
+TEST(MemcachedParserTest, ReuseCommand) {
+    Protocol::Parser parser;
+    Execute::Command cmd;
+
+    size_t consumed = 0, value_size = 0;
+    ASSERT_TRUE(parser.Parse("get some_quite_long_key_1 some_quite_long_key_2\r\n", consumed));
+    ASSERT_TRUE(parser.Build(value_size, cmd));
+    ASSERT_EQ(2, cmd.nkeys());
+
+    cmd.Reset();
+    parser.Reset();
+    ASSERT_FALSE(cmd);
+
+    ASSERT_TRUE(parser.Parse("replace k 1 2 3\r\n", consumed));
+    ASSERT_TRUE(parser.Build(value_size, cmd));
+    ASSERT_EQ(Execute::Command::Type::kReplace, cmd.type());
+    ASSERT_EQ(1, cmd.nkeys());
+    ASSERT_EQ("k", cmd.key());
+    ASSERT_EQ(3, value_size);
+    ASSERT_TRUE(cmd.HasBody());
+}
+
+// Verify names which share prefix with known commands or are too long are not recognized
+TEST(MemcachedParserTest, CommandNames) {
+    std::vector<std::string> unknown = {"se", "setx", "getss", "statsstats", "appendappend", "replaced",
+                                        std::string("\0set", 4)};
+    for (auto &name : unknown) {
+        Protocol::Parser parser;
+        std::string input = name + " key\r\n";
+
+        size_t consumed = 0;
+        ASSERT_TRUE(parser.Parse(input, consumed)) << name;
+        ASSERT_EQ(input.size(), consumed) << name;
+        ASSERT_EQ(Protocol::Parser::Error::kUnknownCommand, parser.GetError()) << name;
+    }
+
+    Protocol::Parser parser;
+    size_t consumed = 0, value_size = 0;
+    Execute::Command cmd;
+    ASSERT_TRUE(parser.Parse("gets a b\r\n", consumed));
+    ASSERT_STREQ("gets", parser.Name());
+    ASSERT_TRUE(parser.Build(value_size, cmd));
+    ASSERT_EQ(Execute::Command::Type::kGets, cmd.type());
+}
+
+// Verify cas command carries unique value
+TEST(MemcachedParserTest, SimpleCas) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse("cas foo 1 0 6 18446744073709551615\r\nfooval\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(36, consumed);
+    ASSERT_STREQ("cas", parser.Name());
+
+    size_t value_size;
+    Execute::Command cmd;
+    ASSERT_TRUE(parser.Build(value_size, cmd));
+    ASSERT_EQ(6, value_size);
+    ASSERT_EQ(Execute::Command::Type::kCas, cmd.type());
+    ASSERT_EQ("foo", cmd.key());
+    ASSERT_EQ(18446744073709551615ull, cmd.cas());
+    ASSERT_TRUE(cmd.HasBody());
+
+    // Unique value is mandatory for cas
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("cas foo 1 0 6\r\n", consumed));
+    ASSERT_EQ(Protocol::Parser::Error::kBadFormat, parser.GetError());
 }
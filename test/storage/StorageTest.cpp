@@ -44,6 +44,26 @@ TEST(StorageTest, PutOverwrite) {
     EXPECT_TRUE(value == "val2");
 }
 
+TEST(StorageTest, PutMove) {
+    SimpleLRU storage;
+
+    // Large enough to be allocated on heap, so the buffer could be handed over
+    std::string value(512, 'x');
+    const char *data = value.data();
+    EXPECT_TRUE(storage.Put("KEY1", std::move(value)));
+
+    const char *stored = nullptr;
+    storage.Update("KEY1", [&stored](std::string &v) {
+        stored = v.data();
+        return false;
+    });
+    EXPECT_EQ(data, stored);
+
+    std::string result;
+    EXPECT_TRUE(storage.Get("KEY1", result));
+    EXPECT_EQ(std::string(512, 'x'), result);
+}
+
 TEST(StorageTest, PutIfAbsent) {
     SimpleLRU storage;
 
@@ -139,6 +159,96 @@ TEST(StorageTest, DeleteHeadAndTailNode)
     EXPECT_TRUE(storage.Delete("KEY1"));
 }
 
+TEST(StorageTest, Update) {
+    SimpleLRU storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Update("KEY1", [](std::string &value) {
+        value.append("tail");
+        return true;
+    }));
+
+    bool called = false;
+    EXPECT_FALSE(storage.Update("KEY2", [&called](std::string &value) {
+        called = true;
+        return true;
+    }));
+    EXPECT_FALSE(called);
+
+    EXPECT_FALSE(storage.Update("KEY1", [](std::string &value) { return false; }));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_TRUE(value == "val1tail");
+}
+
+TEST(StorageTest, UpdateEvicts) {
+    SimpleLRU storage(24);
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+    EXPECT_TRUE(storage.Put("KEY3", "val3"));
+
+    // Grown value pushes out least recently used entries, but not itself
+    EXPECT_TRUE(storage.Update("KEY1", [](std::string &value) {
+        value.append("12345678");
+        return true;
+    }));
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY3", value));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_TRUE(value == "val112345678");
+
+    // Value which could never fit drops the entry
+    EXPECT_FALSE(storage.Update("KEY1", [](std::string &value) {
+        value.append(32, 'x');
+        return true;
+    }));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_TRUE(storage.Get("KEY3", value));
+    EXPECT_TRUE(storage.Put("KEY4", "0123456789ab"));
+}
+
+TEST(StorageTest, Versions) {
+    SimpleLRU storage;
+
+    std::string value;
+    uint64_t v1 = 0, v2 = 0, v3 = 0;
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Get("KEY1", value, v1));
+
+    // Value which got its old data back still has a new version
+    EXPECT_TRUE(storage.Set("KEY1", "val2"));
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Get("KEY1", value, v2));
+    EXPECT_TRUE(value == "val1");
+    EXPECT_NE(v1, v2);
+
+    // Rejected update keeps version, applied one changes it
+    uint64_t seen = 0;
+    EXPECT_FALSE(storage.Update("KEY1", [&seen](std::string &value, uint64_t version) {
+        seen = version;
+        return false;
+    }));
+    EXPECT_EQ(v2, seen);
+    EXPECT_TRUE(storage.Get("KEY1", value, v3));
+    EXPECT_EQ(v2, v3);
+
+    EXPECT_TRUE(storage.Update("KEY1", [](std::string &value) {
+        value.append("tail");
+        return true;
+    }));
+    EXPECT_TRUE(storage.Get("KEY1", value, v3));
+    EXPECT_NE(v2, v3);
+
+    // Versions are never reused by other keys either
+    EXPECT_TRUE(storage.Put("KEY2", "val1"));
+    EXPECT_TRUE(storage.Get("KEY2", value, v1));
+    EXPECT_NE(v3, v1);
+}
+
 std::string pad_space(const std::string &s, size_t length) {
     std::string result = s;
     result.resize(length, ' ');